@@ -18,6 +18,11 @@ class system_contract;
 namespace eosio
 {
 
+namespace native
+{
+class reconciler;
+}
+
 using std::string;
 
 const eosio::symbol PEOS_SYMBOL = symbol(symbol_code("PEOS"), 4);
@@ -35,22 +40,62 @@ class[[eosio::contract("token")]] token : public contract
 
    [[eosio::action]] void issue(name to, asset quantity, string memo);
 
+   struct recipient {
+      name to;
+      asset quantity;
+   };
+
+   [[eosio::action]] void issuemany(const std::vector<recipient> &recipients, string memo);
+
    [[eosio::action]] void retire(asset quantity, string memo);
 
+   // Issuance budget of an account: `total` vests linearly over `duration`
+   // seconds from `start`, nothing before `start + cliff`, in increments of
+   // `step` seconds (0 = continuous). A zero duration vests all at the cliff.
+   // Accounts without a schedule can't be issued to.
+   [[eosio::action]] void setvesting(name account, asset total, uint32_t start, uint32_t cliff, uint32_t duration, uint32_t step);
+   // Stops further issuance to `account`. The row stays with its `issued`
+   // amount, so a later setvesting can't issue the same budget again.
+   [[eosio::action]] void delvesting(name account);
+
    [[eosio::action]] void transfer(name from,
                                    name to,
                                    asset quantity,
                                    string memo);
 
+   [[eosio::action]] void transfermany(name from,
+                                       const std::vector<recipient> &recipients,
+                                       string memo);
+
+   [[eosio::action]] void receipt(name from, name to, asset quantity, string memo);
+
    [[eosio::action]] void claim(name owner, symbol_code sym);
+
+   // Lazy airdrop: the issuer publishes the Merkle root of the snapshot and
+   // each holder claims its own row with a proof. Leaves are
+   // sha256(owner | amount | symbol) over their little-endian binary form,
+   // inner nodes are sha256 of the two children in ascending byte order.
+   [[eosio::action]] void setdroproot(const symbol_code &sym, const checksum256 &root);
+   [[eosio::action]] void claimdrop(name owner, asset quantity, const std::vector<checksum256> &proof);
    [[eosio::action]] void recover(name owner, symbol_code sym);
+   [[eosio::action]] void recovermany(const std::vector<name> &owners, symbol_code sym);
    [[eosio::action]] void open(name owner, const symbol &symbol, name ram_payer);
    [[eosio::action]] void close(name owner, const symbol &symbol);
 
+   // Rewrites the owners' PEOS rows into the compact layout; the contract pays their RAM.
+   // Only in builds with TOKEN_COMPACT_ACCOUNTS.
+   [[eosio::action]] void migrateaccts(const std::vector<name> &owners);
+
+   // Moves the owners' legacy stakes, and the legacy dividend row, to the fixed-point
+   // tables; the contract pays their RAM. Run it with the deploy of this version: until
+   // an owner is migrated, their legacy stake can't be unstaked or realize dividends.
+   [[eosio::action]] void migratestake(const std::vector<name> &owners);
+
    [[eosio::action]] void stake(const name &owner, asset quantity);
    [[eosio::action]] void unstake(const name &owner, asset quantity);
    [[eosio::action]] void realizediv(const name &owner);
    [[eosio::action]] void refund(const name &owner);
+   [[eosio::action]] void procrefunds(uint32_t max);
    [[eosio::action]] void distribute(const name &owner, asset quantity);
 
    struct input {
@@ -64,7 +109,15 @@ class[[eosio::contract("token")]] token : public contract
       asset quantity;
    };
 
+   struct keyinput {
+      public_key pk;
+      std::vector<uint64_t> ids;
+      signature sig;
+   };
+
    [[eosio::action]] void transferutxo(const name &payer, const std::vector<input> &inputs, const std::vector<output> &outputs, const string &memo);
+   [[eosio::action]] void transferkeys(const name &payer, const std::vector<keyinput> &inputs, const std::vector<output> &outputs, const string &memo);
+   [[eosio::action]] void sweeputxo(const name &payer, const public_key &pk, uint32_t max, const signature &sig);
    [[eosio::action]] void loadutxo(const name &from, const public_key &pk, const asset &quantity);
 
    static asset get_supply(name token_contract_account, symbol_code sym_code)
@@ -76,12 +129,91 @@ class[[eosio::contract("token")]] token : public contract
 
    static asset get_balance(name token_contract_account, name owner, symbol_code sym_code)
    {
-      accounts accountstable(token_contract_account, owner.value);
-      const auto &ac = accountstable.get(sym_code.raw());
-      return ac.balance;
+      asset balance;
+      bool found = with_account(token_contract_account, owner, sym_code, [&](auto &, auto ac) {
+         balance = getAccountBalance(*ac);
+      });
+      check(found, "unable to find key");
+      return balance;
+   }
+
+   // What realizediv would pay out to owner right now.
+   [[eosio::action]] void pendingdiv(name owner);
+
+   static asset get_pending_dividends(name token_contract_account, name owner)
+   {
+      user_staked stake;
+      dividend div;
+      if (!find_stake(token_contract_account, owner, stake) || !find_dividend(token_contract_account, div))
+      {
+         return asset(0, PEOS_SYMBOL);
+      }
+
+      return asset(getDividendShare(div, stake), PEOS_SYMBOL);
+   }
+
+   // Everything an indexer needs about one holder's PEOS, without writes.
+   struct account_state {
+      name owner;
+      asset balance;
+      bool claimed;
+      asset staked;
+      asset pending_dividends;
+      asset refunding;
+      uint32_t refund_request_time; // of the oldest pending tranche
+   };
+
+   // cdt 1.5 actions can't return values, so this prints a JSON array of account_state
+   [[eosio::action]] void getaccounts(const std::vector<name> &owners);
+
+   static account_state get_account_state(name token_contract_account, name owner)
+   {
+      account_state state{owner, asset(0, PEOS_SYMBOL), false, asset(0, PEOS_SYMBOL),
+                          asset(0, PEOS_SYMBOL), asset(0, PEOS_SYMBOL), 0};
+
+      with_account(token_contract_account, owner, PEOS_SYMBOL.code(), [&](auto &, auto ac) {
+         state.balance = getAccountBalance(*ac);
+         state.claimed = isAccountClaimed(*ac);
+      });
+
+      user_staked stake;
+      if (find_stake(token_contract_account, owner, stake))
+      {
+         state.staked = stake.quantity;
+
+         dividend div;
+         if (find_dividend(token_contract_account, div))
+         {
+            state.pending_dividends.amount = getDividendShare(div, stake);
+         }
+      }
+
+      refunds_table refunds(token_contract_account, owner.value);
+      auto req = refunds.find(owner.value);
+      if (req != refunds.end())
+      {
+         state.refunding = req->amount;
+         state.refund_request_time = req->request_time;
+      }
+
+      refund_queue queue(token_contract_account, token_contract_account.value);
+      auto byowner = queue.get_index<"byowner"_n>();
+      for (auto tranche = byowner.lower_bound(owner.value); tranche != byowner.end() && tranche->owner == owner; ++tranche)
+      {
+         if (state.refunding.amount == 0)
+         {
+            state.refund_request_time = tranche->request_time;
+         }
+         state.refunding += tranche->amount;
+      }
+
+      return state;
    }
 
  private:
+   // checks dumps of these tables offline, decoding rows with the structs below
+   friend class native::reconciler;
+
    struct [[eosio::table]] account
    {
       asset balance;
@@ -89,6 +221,19 @@ class[[eosio::contract("token")]] token : public contract
       uint64_t primary_key() const { return balance.symbol.code().raw(); }
    };
 
+   // PEOS rows, 8 bytes instead of 17: the amount in the low 63 bits, claimed in
+   // the top bit. The table holds the single symbol, so it is implied.
+   // Written only by builds with TOKEN_COMPACT_ACCOUNTS: get_currency_balance
+   // and indexers read the accounts table and don't see these balances.
+   struct [[eosio::table]] compact_account
+   {
+      uint64_t packed;
+
+      static constexpr uint64_t CLAIMED_BIT = 1ull << 63;
+
+      uint64_t primary_key() const { return PEOS_SYMBOL.code().raw(); }
+   };
+
    struct [[eosio::table]] currency_stats
    {
       asset supply;
@@ -124,48 +269,161 @@ class[[eosio::contract("token")]] token : public contract
       uint64_t primary_key() const { return account.value; }
    };
 
+   struct [[eosio::table]] vesting_schedule
+   {
+      name account;
+      asset total;
+      asset issued;
+      uint32_t start;
+      uint32_t cliff;
+      uint32_t duration;
+      uint32_t step;
+
+      uint64_t primary_key() const { return account.value; }
+      int64_t vested(uint32_t time) const;
+   };
+
    typedef eosio::multi_index<"accounts"_n, account> accounts;
+   typedef eosio::multi_index<"accts"_n, compact_account> compact_accounts;
    typedef eosio::multi_index<"stat"_n, currency_stats> stats;
    typedef eosio::multi_index<"teamvest"_n, team_vesting> vesting;
+   typedef eosio::multi_index<"vestsched"_n, vesting_schedule> vesting_schedules;
    typedef eosio::multi_index<"utxos"_n, 
                               utxo,
                               indexed_by<"ipk"_n, const_mem_fun<utxo, checksum256, &utxo::by_pk>>
                               > utxos;
    typedef eosio::multi_index<"utxoglobals"_n, utxo_global> utxo_globals;
 
+   struct [[eosio::table]] drop_root
+   {
+      symbol_code sym;
+      checksum256 root;
+
+      uint64_t primary_key() const { return sym.raw(); }
+   };
+
+   struct [[eosio::table]] drop_claim
+   {
+      name owner;
+
+      uint64_t primary_key() const { return owner.value; }
+   };
+
+   typedef eosio::multi_index<"droproots"_n, drop_root> drop_roots;
+   typedef eosio::multi_index<"dropclaims"_n, drop_claim> drop_claims;
+
+   static asset getAccountBalance(const account &a) { return a.balance; }
+   static asset getAccountBalance(const compact_account &a)
+   {
+      return asset((int64_t)(a.packed & ~compact_account::CLAIMED_BIT), PEOS_SYMBOL);
+   }
+
+   static bool isAccountClaimed(const account &a) { return a.claimed; }
+   static bool isAccountClaimed(const compact_account &a) { return a.packed & compact_account::CLAIMED_BIT; }
+
+   static void setAccount(account &a, const asset &balance, bool claimed)
+   {
+      a.balance = balance;
+      a.claimed = claimed;
+   }
+   static void setAccount(compact_account &a, const asset &balance, bool claimed)
+   {
+      a.packed = (uint64_t)balance.amount | (claimed ? compact_account::CLAIMED_BIT : 0);
+   }
+
+   // Calls f(table, row) on the owner's balance row, compact or not; false if there is none.
+   // Until migrated, PEOS rows may still be in the accounts table. Builds without
+   // TOKEN_COMPACT_ACCOUNTS only look in accounts.
+   template <typename F>
+   static bool with_account(name token_contract_account, name owner, symbol_code sym, F &&f)
+   {
+#ifdef TOKEN_COMPACT_ACCOUNTS
+      if (sym == PEOS_SYMBOL.code())
+      {
+         compact_accounts compact(token_contract_account, owner.value);
+         auto row = compact.find(sym.raw());
+         if (row != compact.end())
+         {
+            f(compact, row);
+            return true;
+         }
+      }
+#endif
+
+      accounts acnts(token_contract_account, owner.value);
+      auto row = acnts.find(sym.raw());
+      if (row != acnts.end())
+      {
+         f(acnts, row);
+         return true;
+      }
+      return false;
+   }
+
+   void emplace_account(name owner, const asset &balance, bool claimed, name ram_payer);
+
    static inline checksum256 getKeyHash(const public_key &pk)
    {
       return sha256(pk.data.begin(), 33);
    }
 
+   static checksum256 getDropLeafHash(name owner, const asset &quantity);
+   static checksum256 getDropNodeHash(const checksum256 &a, const checksum256 &b);
+
    void sub_balance(name owner, asset value);
    void add_balance(name owner, asset value, name ram_payer, bool claimed);
+   /// Adds to an existing balance row; false if `owner` has none.
+   bool credit_balance(name owner, asset value);
+   void move_balance(name from, name to, asset quantity, const string &memo);
 
    void do_claim(name owner, symbol_code sym, name payer);
 
-   uint64_t getNextUTXOId();
+   /// Reserves `count` consecutive UTXO ids with a single write and returns the first.
+   uint64_t reserveUTXOIds(uint64_t count);
+   static checksum256 getOutputsDigest(const std::vector<output> &outputs);
+   void payUTXOOutputs(utxos &utxostable, const name &payer, const asset &inputSum, const std::vector<output> &outputs, const string &memo);
+
+   /// dividendsPerShare is a fixed-point value with this many fractional bits.
+   static constexpr uint32_t DIVIDEND_FRACTION_BITS = 64;
 
    struct [[eosio::table]] user_staked 
    {
       asset quantity;
-      double lastDividendsFrac;
+      uint128_t lastDividendsPerShare;
 
       uint64_t primary_key() const { return quantity.symbol.code().raw(); }
    };
 
-   typedef eosio::multi_index<"staked"_n, user_staked> staked;
+   typedef eosio::multi_index<"stakes"_n, user_staked> staked;
 
+   // Only distribute writes the dividend row. Stake changes and realized
+   // payouts are accumulated in DIVIDEND_SHARDS shard rows picked by owner,
+   // so the effective totals are
+   //    staked    = totalStaked + sum(shard.staked)
+   //    unclaimed = totalUnclaimedDividends - sum(shard.realized)
    struct [[eosio::table]] dividend 
    {
       asset totalStaked;
       asset totalDividends;
       asset totalUnclaimedDividends;
 
-      double totalDividendFrac;
+      uint128_t dividendsPerShare;
+      uint64_t dividendsRemainder;
 
       uint64_t primary_key() const { return totalStaked.symbol.code().raw(); }
    };
 
+   static constexpr uint64_t DIVIDEND_SHARDS = 16;
+
+   struct [[eosio::table]] dividend_shard
+   {
+      uint64_t id;
+      asset staked;
+      asset realized;
+
+      uint64_t primary_key() const { return id; }
+   };
+
    struct [[eosio::table]] refund_request {
       name            owner;
       uint32_t  request_time;
@@ -175,14 +433,145 @@ class[[eosio::contract("token")]] token : public contract
       uint64_t  primary_key()const { return owner.value; }
    };
 
-   typedef eosio::multi_index<"dividends"_n, dividend> dividends;
+   typedef eosio::multi_index<"divtotals"_n, dividend> dividends;
+   typedef eosio::multi_index<"divshards"_n, dividend_shard> dividend_shards;
    typedef eosio::multi_index<"refunds"_n, refund_request> refunds_table;
 
-   static constexpr name PEOS_CONTRACT_ACCOUNT    = "thepeostoken"_n;
-   static constexpr name PEOS_MARKETING_ACCOUNT   = "peosmarketin"_n;
-   static constexpr name PEOS_TEAMFUND_ACCOUNT    = "peosteamfund"_n;
+   // Pending refunds of all owners in _self scope, oldest first through bytime.
+   // Each unstake opens its own tranche that matures independently; an owner
+   // holds at most MAX_REFUND_TRANCHES, after which unstakes merge into the
+   // newest one. Within byowner an owner's tranches are in id, hence time, order.
+   // Rows in the former owner-scoped refunds table are still honoured by refund
+   // and move here the next time their owner unstakes.
+   static constexpr uint32_t MAX_REFUND_TRANCHES = 8;
+
+   struct [[eosio::table]] refund_entry
+   {
+      uint64_t id;
+      name owner;
+      uint32_t request_time;
+      asset amount;
+
+      uint64_t primary_key() const { return id; }
+      uint64_t by_owner() const { return owner.value; }
+      uint64_t by_time() const { return request_time; }
+   };
+
+   typedef eosio::multi_index<"refundqueue"_n, 
+                              refund_entry,
+                              indexed_by<"byowner"_n, const_mem_fun<refund_entry, uint64_t, &refund_entry::by_owner>>,
+                              indexed_by<"bytime"_n, const_mem_fun<refund_entry, uint64_t, &refund_entry::by_time>>
+                              > refund_queue;
+
+   // Rows from before dividends were fixed point, still in their old tables.
+   // migratestake moves them to stakes and divtotals; the dividend row also
+   // moves when stake or distribute would otherwise create divtotals. Staking
+   // actions don't look at legacy stakes, but readers convert them on the fly.
+   struct [[eosio::table]] legacy_stake
+   {
+      asset quantity;
+      double lastDividendsFrac;
+
+      uint64_t primary_key() const { return quantity.symbol.code().raw(); }
+   };
+
+   struct [[eosio::table]] legacy_dividend
+   {
+      asset totalStaked;
+      asset totalDividends;
+      asset totalUnclaimedDividends;
+      double totalDividendFrac;
+
+      uint64_t primary_key() const { return totalStaked.symbol.code().raw(); }
+   };
+
+   typedef eosio::multi_index<"staked"_n, legacy_stake> legacy_stakes;
+   typedef eosio::multi_index<"dividends"_n, legacy_dividend> legacy_dividends;
+
+   // Exact: the integer part, and the fraction scaled by a power of two. Stakes
+   // and the dividend row go through the same monotonic mapping, so the
+   // difference each payout uses is kept.
+   static uint128_t getDividendsPerShare(double frac)
+   {
+      check(frac >= 0 && frac < 18446744073709551616.0, "legacy dividend fraction out of range");
+      const uint64_t whole = (uint64_t)frac;
+      const uint64_t fraction = (uint64_t)((frac - (double)whole) * 18446744073709551616.0);
+      return ((uint128_t)whole << DIVIDEND_FRACTION_BITS) | fraction;
+   }
+
+   static user_staked getStake(const legacy_stake &s)
+   {
+      return user_staked{s.quantity, getDividendsPerShare(s.lastDividendsFrac)};
+   }
+
+   static dividend getDividend(const legacy_dividend &d)
+   {
+      return dividend{d.totalStaked, d.totalDividends, d.totalUnclaimedDividends,
+                      getDividendsPerShare(d.totalDividendFrac), 0};
+   }
+
+   // The owner's PEOS stake in either layout; false if there is none.
+   static bool find_stake(name token_contract_account, name owner, user_staked &stake)
+   {
+      const auto sym = PEOS_SYMBOL.code().raw();
+      staked stakedtable(token_contract_account, owner.value);
+      auto row = stakedtable.find(sym);
+      if (row != stakedtable.end())
+      {
+         stake = *row;
+         return true;
+      }
+
+      legacy_stakes legacy(token_contract_account, owner.value);
+      auto old = legacy.find(sym);
+      if (old != legacy.end())
+      {
+         stake = getStake(*old);
+         return true;
+      }
+      return false;
+   }
+
+   // The PEOS dividend row in either layout; false if there is none.
+   static bool find_dividend(name token_contract_account, dividend &div)
+   {
+      const auto sym = PEOS_SYMBOL.code().raw();
+      dividends dividendtable(token_contract_account, token_contract_account.value);
+      auto row = dividendtable.find(sym);
+      if (row != dividendtable.end())
+      {
+         div = *row;
+         return true;
+      }
+
+      legacy_dividends legacy(token_contract_account, token_contract_account.value);
+      auto old = legacy.find(sym);
+      if (old != legacy.end())
+      {
+         div = getDividend(*old);
+         return true;
+      }
+      return false;
+   }
+
+   /// Moves the legacy dividend row, if there is one, to divtotals.
+   dividends::const_iterator migrate_dividend(dividends &dividend);
+
+   static int64_t getDividendShare(const dividend &div, const user_staked &stake)
+   {
+      // bounded by the dividends distributed since the last realization, so no overflow
+      return (int64_t)(((div.dividendsPerShare - stake.lastDividendsPerShare) * (uint64_t)stake.quantity.amount) >> DIVIDEND_FRACTION_BITS);
+   }
+
+   static uint64_t getDividendShardId(name owner)
+   {
+      // Fibonacci hashing; the top 4 bits pick one of the 16 shards
+      return (owner.value * 0x9E3779B97F4A7C15ull) >> 60;
+   }
+
+   void add_dividend_shard(name owner, int64_t staked, int64_t realized);
 
-   void validate_peos_team_vesting(name account, asset quantity);
+   void validate_vesting(name account, asset quantity);
 };
 
 } // namespace eosio
\ No newline at end of file
@@ -0,0 +1,466 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Per-action cost of the token contract on the native harness. Besides
+ *  wall time every benchmark reports, per iteration, the table operations
+ *  (finds/emplaces/modifies/erases) and inline actions the action caused.
+ */
+
+#include <native/token_tester.hpp>
+
+#include <benchmark/benchmark.h>
+
+using eosio::asset;
+using eosio::name;
+using eosio::native::token_tester;
+using namespace eosio::native;
+
+namespace
+{
+
+const name alice = "alice"_n;
+const name bob = "bob"_n;
+
+class counters
+{
+ public:
+   explicit counters(token_tester &t) : _chain(t.get_chain())
+   {
+      _chain.db().reset_counters();
+      _inline = _chain.inline_actions_sent();
+   }
+
+   /// Excludes the table operations of paused setup work.
+   void pause(benchmark::State &state)
+   {
+      state.PauseTiming();
+      _excluded = _chain.db().counters();
+      _excluded_inline = _chain.inline_actions_sent();
+   }
+
+   void resume(benchmark::State &state)
+   {
+      auto now = _chain.db().counters();
+      _skipped.finds += now.finds - _excluded.finds;
+      _skipped.emplaces += now.emplaces - _excluded.emplaces;
+      _skipped.modifies += now.modifies - _excluded.modifies;
+      _skipped.erases += now.erases - _excluded.erases;
+      _skipped_inline += _chain.inline_actions_sent() - _excluded_inline;
+      state.ResumeTiming();
+   }
+
+   void report(benchmark::State &state)
+   {
+      const auto &c = _chain.db().counters();
+      const auto avg = benchmark::Counter::kAvgIterations;
+      state.counters["finds"] = benchmark::Counter(double(c.finds - _skipped.finds), avg);
+      state.counters["emplaces"] = benchmark::Counter(double(c.emplaces - _skipped.emplaces), avg);
+      state.counters["modifies"] = benchmark::Counter(double(c.modifies - _skipped.modifies), avg);
+      state.counters["erases"] = benchmark::Counter(double(c.erases - _skipped.erases), avg);
+      state.counters["inline"] = benchmark::Counter(double(_chain.inline_actions_sent() - _inline - _skipped_inline), avg);
+   }
+
+ private:
+   chain &_chain;
+   db_counters _excluded;
+   db_counters _skipped;
+   uint64_t _inline = 0;
+   uint64_t _excluded_inline = 0;
+   uint64_t _skipped_inline = 0;
+};
+
+void BM_transfer(benchmark::State &state)
+{
+   token_tester t;
+   t.create_accounts({alice, bob});
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+   t.fund(bob, token_tester::peos(1'000'000'0000));
+
+   counters c(t);
+   bool forward = true;
+   for (auto _ : state)
+   {
+      t.transfer(forward ? alice : bob, forward ? bob : alice, token_tester::peos(1));
+      forward = !forward;
+   }
+   c.report(state);
+}
+BENCHMARK(BM_transfer);
+
+void BM_transfermany(benchmark::State &state)
+{
+   token_tester t;
+   t.create_account(alice);
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+
+   std::vector<eosio::token::recipient> recipients;
+   for (int64_t i = 0; i < state.range(0); ++i)
+   {
+      auto to = token_tester::account_name(i);
+      t.create_account(to);
+      recipients.push_back({to, token_tester::peos(1)});
+   }
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      t.transfermany(alice, recipients);
+   }
+   c.report(state);
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_transfermany)->Arg(1)->Arg(16)->Arg(256);
+
+void BM_issue(benchmark::State &state)
+{
+   token_tester t;
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      t.issue(token_tester::marketing_account, token_tester::peos(1));
+   }
+   c.report(state);
+}
+BENCHMARK(BM_issue);
+
+void BM_issuemany(benchmark::State &state)
+{
+   token_tester t;
+
+   // only the budget accounts may still be issued to
+   std::vector<eosio::token::recipient> recipients;
+   for (int64_t i = 0; i < state.range(0); ++i)
+   {
+      recipients.push_back({i % 2 ? token_tester::marketing_account : token_tester::contract_account,
+                            token_tester::peos(1)});
+   }
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      t.issuemany(recipients);
+   }
+   c.report(state);
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_issuemany)->Arg(2)->Arg(64);
+
+void BM_claim(benchmark::State &state)
+{
+   token_tester t;
+   t.issue(token_tester::contract_account, token_tester::peos(100'000'0000));
+
+   counters c(t);
+   uint64_t index = 0;
+   for (auto _ : state)
+   {
+      c.pause(state);
+      auto owner = token_tester::account_name(index++);
+      t.create_account(owner);
+      t.transfer(token_tester::contract_account, owner, token_tester::peos(1));
+      c.resume(state);
+
+      t.claim(owner);
+   }
+   c.report(state);
+}
+BENCHMARK(BM_claim);
+
+void BM_setdroproot(benchmark::State &state)
+{
+   token_tester t;
+
+   counters c(t);
+   int64_t index = 0;
+   for (auto _ : state)
+   {
+      t.setdroproot(token_tester::drop_leaf_hash(alice, token_tester::peos(++index)));
+   }
+   c.report(state);
+}
+BENCHMARK(BM_setdroproot);
+
+void BM_claimdrop(benchmark::State &state)
+{
+   token_tester t;
+   t.issue(token_tester::contract_account, token_tester::peos(100'000'0000));
+
+   counters c(t);
+   uint64_t index = 0;
+   for (auto _ : state)
+   {
+      c.pause(state);
+      // a fresh root per claimant, with a proof of the given depth
+      auto owner = token_tester::account_name(index++);
+      t.create_account(owner);
+      auto node = token_tester::drop_leaf_hash(owner, token_tester::peos(1));
+      std::vector<eosio::checksum256> proof;
+      for (int64_t i = 0; i < state.range(0); ++i)
+      {
+         proof.push_back(token_tester::drop_leaf_hash(bob, token_tester::peos(i + 1)));
+         node = token_tester::drop_node_hash(node, proof.back());
+      }
+      t.setdroproot(node);
+      c.resume(state);
+
+      t.claimdrop(owner, token_tester::peos(1), proof);
+   }
+   c.report(state);
+}
+BENCHMARK(BM_claimdrop)->Arg(1)->Arg(20);
+
+void BM_recovermany(benchmark::State &state)
+{
+   token_tester t;
+   t.issue(token_tester::contract_account, token_tester::peos(100'000'0000));
+
+   counters c(t);
+   uint64_t index = 0;
+   for (auto _ : state)
+   {
+      c.pause(state);
+      std::vector<name> owners;
+      for (int64_t i = 0; i < state.range(0); ++i)
+      {
+         auto owner = token_tester::account_name(index++);
+         t.create_account(owner);
+         t.transfer(token_tester::contract_account, owner, token_tester::peos(1));
+         owners.push_back(owner);
+      }
+      c.resume(state);
+
+      t.recovermany(owners);
+   }
+   c.report(state);
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_recovermany)->Arg(1)->Arg(256);
+
+void BM_stake(benchmark::State &state)
+{
+   token_tester t;
+   t.create_account(alice);
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      t.stake(alice, token_tester::peos(1));
+   }
+   c.report(state);
+}
+BENCHMARK(BM_stake);
+
+void BM_unstake(benchmark::State &state)
+{
+   token_tester t;
+   t.create_account(alice);
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+   t.stake(alice, token_tester::peos(1'000'000'0000));
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      t.unstake(alice, token_tester::peos(1));
+   }
+   c.report(state);
+}
+BENCHMARK(BM_unstake);
+
+void BM_refund(benchmark::State &state)
+{
+   token_tester t;
+   t.create_account(alice);
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+   t.stake(alice, token_tester::peos(1'000'000'0000));
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      c.pause(state);
+      // one tranche per unstake
+      for (int64_t i = 0; i < state.range(0); ++i)
+      {
+         t.get_chain().advance_time(1);
+         t.unstake(alice, token_tester::peos(1));
+      }
+      t.get_chain().advance_time(3 * 24 * 3600);
+      c.resume(state);
+
+      t.refund(alice);
+   }
+   c.report(state);
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_refund)->Arg(1)->Arg(8);
+
+void BM_procrefunds(benchmark::State &state)
+{
+   token_tester t;
+   std::vector<name> owners;
+   for (int64_t i = 0; i < state.range(0); ++i)
+   {
+      owners.push_back(token_tester::account_name(i));
+      t.create_account(owners.back());
+      t.fund(owners.back(), token_tester::peos(100'000'0000));
+      t.stake(owners.back(), token_tester::peos(100'000'0000));
+   }
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      c.pause(state);
+      for (auto owner : owners)
+      {
+         t.unstake(owner, token_tester::peos(1));
+      }
+      t.get_chain().advance_time(3 * 24 * 3600);
+      c.resume(state);
+
+      t.procrefunds(uint32_t(owners.size()));
+   }
+   c.report(state);
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_procrefunds)->Arg(1)->Arg(64);
+
+void BM_realizediv(benchmark::State &state)
+{
+   token_tester t;
+   t.create_accounts({alice, bob});
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+   t.fund(bob, token_tester::peos(1'000'000'0000));
+   t.stake(alice, token_tester::peos(1'000'0000));
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      c.pause(state);
+      t.distribute(bob, token_tester::peos(10));
+      c.resume(state);
+
+      t.realizediv(alice);
+   }
+   c.report(state);
+}
+BENCHMARK(BM_realizediv);
+
+void BM_distribute(benchmark::State &state)
+{
+   token_tester t;
+   t.create_accounts({alice, bob});
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+   t.fund(bob, token_tester::peos(1'000'000'0000));
+   t.stake(alice, token_tester::peos(1'000'0000));
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      t.distribute(bob, token_tester::peos(1));
+   }
+   c.report(state);
+}
+BENCHMARK(BM_distribute);
+
+void BM_transferutxo(benchmark::State &state)
+{
+   const auto inputs = state.range(0);
+   const auto outputs = state.range(1);
+
+   token_tester t;
+   t.create_accounts({alice, bob});
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+
+   auto key = private_key::from_seed("bench");
+   std::vector<eosio::token::output> outs(outputs, {key.get_public_key(), name(), token_tester::peos(1)});
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      c.pause(state);
+      std::vector<eosio::token::input> ins;
+      for (int64_t i = 0; i < inputs; ++i)
+      {
+         auto id = t.next_utxo_id();
+         t.loadutxo(alice, key.get_public_key(), token_tester::peos(outputs));
+         ins.push_back({id, key.sign(token_tester::utxo_digest(id, outs))});
+      }
+      c.resume(state);
+
+      t.transferutxo(bob, ins, outs);
+   }
+   c.report(state);
+}
+BENCHMARK(BM_transferutxo)->Args({1, 1})->Args({1, 16})->Args({16, 1})->Args({16, 16})->Args({50, 50});
+
+void BM_transferkeys(benchmark::State &state)
+{
+   const auto inputs = state.range(0);
+   const auto outputs = state.range(1);
+
+   token_tester t;
+   t.create_accounts({alice, bob});
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+
+   auto key = private_key::from_seed("bench");
+   std::vector<eosio::token::output> outs(outputs, {key.get_public_key(), name(), token_tester::peos(1)});
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      c.pause(state);
+      eosio::token::keyinput in{key.get_public_key(), {}, {}};
+      for (int64_t i = 0; i < inputs; ++i)
+      {
+         in.ids.push_back(t.next_utxo_id());
+         t.loadutxo(alice, key.get_public_key(), token_tester::peos(outputs));
+      }
+      in.sig = key.sign(token_tester::utxo_key_digest(in.ids, outs));
+      c.resume(state);
+
+      t.transferkeys(bob, {in}, outs);
+   }
+   c.report(state);
+}
+BENCHMARK(BM_transferkeys)->Args({1, 1})->Args({16, 1})->Args({16, 16})->Args({50, 50});
+
+void BM_sweeputxo(benchmark::State &state)
+{
+   const auto count = uint32_t(state.range(0));
+
+   token_tester t;
+   t.create_accounts({alice, bob});
+   t.fund(alice, token_tester::peos(1'000'000'0000));
+
+   auto key = private_key::from_seed("bench");
+
+   counters c(t);
+   for (auto _ : state)
+   {
+      c.pause(state);
+      auto first = t.next_utxo_id();
+      for (uint32_t i = 0; i < count; ++i)
+      {
+         t.loadutxo(alice, key.get_public_key(), token_tester::peos(1));
+      }
+      auto sig = key.sign(token_tester::utxo_sweep_digest(first, count));
+      c.resume(state);
+
+      t.sweeputxo(bob, key.get_public_key(), count, sig);
+
+      c.pause(state);
+      // spend the merged UTXO so the next sweep starts from fresh rows
+      std::vector<eosio::token::output> outs = {{eosio::public_key(), bob, token_tester::peos(count)}};
+      auto merged = t.next_utxo_id() - 1;
+      t.transferutxo(bob, {{merged, key.sign(token_tester::utxo_digest(merged, outs))}}, outs);
+      c.resume(state);
+   }
+   c.report(state);
+}
+BENCHMARK(BM_sweeputxo)->Arg(2)->Arg(16)->Arg(100);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Prints the RAM profile of each token action: rows emplaced/modified/erased
+ *  per table, bytes billed per payer and inline actions sent. Output is
+ *  deterministic, so diffing it against a previous run flags regressions.
+ *  Only built with -DTOKEN_NATIVE_INSTRUMENT=ON.
+ */
+
+#include <native/token_tester.hpp>
+
+#include <cstdio>
+#include <functional>
+
+using eosio::name;
+using eosio::native::token_tester;
+using namespace eosio::native;
+
+namespace
+{
+
+const name alice = "alice"_n;
+const name bob = "bob"_n;
+
+void print(const action_profile &p)
+{
+   std::printf("%*s%s::%s", int(p.depth * 2), "", p.account.to_string().c_str(), p.action.to_string().c_str());
+   if (p.receiver != p.account)
+   {
+      std::printf(" -> %s", p.receiver.to_string().c_str());
+   }
+   std::printf("  inline=%u\n", p.inline_actions);
+
+   for (const auto &[table, ops] : p.tables)
+   {
+      std::printf("%*s  %-12s emplaced=%llu modified=%llu erased=%llu\n", int(p.depth * 2), "",
+                  table.to_string().c_str(), (unsigned long long)ops.emplaced,
+                  (unsigned long long)ops.modified, (unsigned long long)ops.erased);
+   }
+   for (const auto &[payer, bytes] : p.ram_deltas)
+   {
+      std::printf("%*s  ram %-12s %+lld\n", int(p.depth * 2), "", payer.to_string().c_str(), (long long)bytes);
+   }
+}
+
+/// Runs `setup` unprofiled, then prints the profile of everything `act` pushes.
+void profile(const char *title, const std::function<void(token_tester &)> &setup,
+             const std::function<void(token_tester &)> &act)
+{
+   token_tester t;
+   t.create_accounts({alice, bob});
+   setup(t);
+
+   std::printf("== %s\n", title);
+   t.get_chain().set_profile_hook(&print);
+   act(t);
+   t.get_chain().set_profile_hook(nullptr);
+   std::printf("\n");
+}
+
+void none(token_tester &) {}
+
+} // namespace
+
+int main()
+{
+   const auto peos = &token_tester::peos;
+   auto funded = [&](token_tester &t) {
+      t.fund(alice, peos(1'000'0000));
+   };
+   auto staked = [&](token_tester &t) {
+      funded(t);
+      t.fund(bob, peos(1'000'0000));
+      t.stake(alice, peos(100'0000));
+   };
+   auto key = private_key::from_seed("profile");
+
+   profile("issue", none, [&](token_tester &t) { t.issue(token_tester::marketing_account, peos(1'0000)); });
+   profile("transfer (new recipient)", funded, [&](token_tester &t) { t.transfer(alice, bob, peos(1'0000)); });
+   profile("transfer (existing recipient)", [&](token_tester &t) {
+      funded(t);
+      t.fund(bob, peos(1'0000));
+   }, [&](token_tester &t) { t.transfer(alice, bob, peos(1'0000)); });
+   profile("transfermany (4 recipients)", funded, [&](token_tester &t) {
+      std::vector<eosio::token::recipient> recipients;
+      for (uint64_t i = 0; i < 4; ++i)
+      {
+         t.create_account(token_tester::account_name(i));
+         recipients.push_back({token_tester::account_name(i), peos(1'0000)});
+      }
+      t.transfermany(alice, recipients);
+   });
+   profile("claim", [&](token_tester &t) {
+      t.issue(token_tester::contract_account, peos(1'0000));
+      t.transfer(token_tester::contract_account, bob, peos(1'0000));
+   }, [&](token_tester &t) { t.claim(bob); });
+   profile("stake", funded, [&](token_tester &t) { t.stake(alice, peos(100'0000)); });
+   profile("unstake", staked, [&](token_tester &t) { t.unstake(alice, peos(10'0000)); });
+   profile("refund", [&](token_tester &t) {
+      staked(t);
+      t.unstake(alice, peos(10'0000));
+      t.get_chain().advance_time(3 * 24 * 3600);
+   }, [&](token_tester &t) { t.refund(alice); });
+   profile("distribute", staked, [&](token_tester &t) { t.distribute(bob, peos(1'0000)); });
+   profile("realizediv", [&](token_tester &t) {
+      staked(t);
+      t.distribute(bob, peos(1'0000));
+   }, [&](token_tester &t) { t.realizediv(alice); });
+   profile("loadutxo", funded, [&](token_tester &t) { t.loadutxo(alice, key.get_public_key(), peos(10'0000)); });
+   profile("transferutxo (1 in, 2 out)", [&](token_tester &t) {
+      funded(t);
+      t.loadutxo(alice, key.get_public_key(), peos(10'0000));
+   }, [&](token_tester &t) {
+      std::vector<eosio::token::output> outs = {{key.get_public_key(), name(), peos(4'0000)},
+                                                {eosio::public_key(), bob, peos(6'0000)}};
+      std::vector<eosio::token::input> ins = {{0, key.sign(token_tester::utxo_digest(0, outs))}};
+      t.transferutxo(bob, ins, outs);
+   });
+   return 0;
+}
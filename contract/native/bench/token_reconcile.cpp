@@ -0,0 +1,136 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Reconciles a checkpoint of the token's tables, e.g. one written by
+ *  token_replay: per symbol the balances must add up to the supply, and the
+ *  contract's balance must cover stakes, refunds, UTXOs and unrealized
+ *  dividends. Prints the totals and every discrepancy with its owner.
+ *
+ *      token_reconcile [options] <checkpoint>
+ *
+ *  Exits with 0 when the ledger reconciles and 2 when it doesn't.
+ */
+
+#include <native/reconcile.hpp>
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+using namespace eosio;
+using namespace eosio::native;
+
+namespace
+{
+
+void usage()
+{
+   std::cerr <<
+      "usage: token_reconcile [options] <checkpoint>\n"
+      "\n"
+      "  --contract ACCOUNT       account running the token contract (thepeostoken)\n"
+      "  --threads N              worker threads, 0 for every core (0)\n"
+      "  --max-reports N          discrepancies listed, all are counted (1000)\n"
+      "  --read-ahead MB          tables read ahead of the workers (64)\n";
+}
+
+std::string peos(int128_t amount)
+{
+   return format_amount(amount, PEOS_SYMBOL);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   try
+   {
+      reconcile_options options;
+      std::string path;
+      for (int i = 1; i < argc; ++i)
+      {
+         std::string arg = argv[i];
+         auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+               throw std::runtime_error(arg + " needs a value");
+            }
+            return argv[++i];
+         };
+
+         if (arg == "--contract")
+            options.contract = name(value());
+         else if (arg == "--threads")
+            options.threads = unsigned(std::stoul(value()));
+         else if (arg == "--max-reports")
+            options.max_reports = std::stoull(value());
+         else if (arg == "--read-ahead")
+            options.read_ahead = std::stoull(value()) << 20;
+         else if (arg == "-h" || arg == "--help")
+         {
+            usage();
+            return 0;
+         }
+         else if (!arg.empty() && arg[0] == '-')
+            throw std::runtime_error("unknown option " + arg);
+         else
+            path = arg;
+      }
+      if (path.empty())
+      {
+         usage();
+         return 1;
+      }
+
+      reconciler checker(options);
+      const auto report = checker.check(path);
+
+      printf("checkpoint after %llu actions: %llu tables, %llu rows, checked in %.3f s\n\n",
+             (unsigned long long)report.position, (unsigned long long)report.tables, (unsigned long long)report.rows,
+             report.seconds);
+
+      for (const auto &s : report.supplies)
+      {
+         printf("%-8s supply %s, balances %s of %llu holders\n", s.sym.code().to_string().c_str(),
+                s.has_stat ? format_amount(s.supply, s.sym).c_str() : "missing",
+                format_amount(s.balances, s.sym).c_str(), (unsigned long long)s.holders);
+      }
+
+      const auto &c = report.custody;
+      printf("\nheld by %s: %s\n"
+             "  staked      %s by %llu stakers\n"
+             "  refunding   %s in %llu tranches\n"
+             "  utxos       %s in %llu outputs\n"
+             "  dividends   %s unrealized, %s owed to stakers, %s pending\n"
+             "  free        %s\n",
+             options.contract.to_string().c_str(), peos(c.contract_balance).c_str(), peos(c.staked).c_str(),
+             (unsigned long long)c.stakers, peos(c.refunding).c_str(), (unsigned long long)c.refund_tranches,
+             peos(c.utxos).c_str(), (unsigned long long)c.utxo_count, peos(c.unclaimed_dividends).c_str(),
+             peos(c.owed_dividends).c_str(), peos(c.pending_dividends).c_str(),
+             peos(c.contract_balance - c.liabilities()).c_str());
+
+      if (report.ok())
+      {
+         printf("\nledger reconciles\n");
+         return 0;
+      }
+
+      printf("\n%llu discrepancies", (unsigned long long)report.discrepancy_count);
+      if (report.discrepancies.size() < report.discrepancy_count)
+      {
+         printf(", the first %zu by owner", report.discrepancies.size());
+      }
+      printf(":\n");
+      for (const auto &d : report.discrepancies)
+      {
+         printf("  %-12s  %-12s  %s\n", d.owner.to_string().c_str(), d.table.to_string().c_str(), d.message.c_str());
+      }
+      return 2;
+   }
+   catch (const std::exception &e)
+   {
+      fprintf(stderr, "token_reconcile: %s\n", e.what());
+      return 1;
+   }
+}
@@ -0,0 +1,277 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Replays a captured action log through the contract on the native chain,
+ *  checkpointing state along the way, and reports the throughput. Run it on
+ *  the same mainnet capture before and after a contract change to compare.
+ *
+ *      token_replay [options] <log>
+ *      token_replay convert <actions.jsonl> <log>
+ *
+ *  convert reads one action per line as nodeos prints them, with hex data
+ *  and an optional "block_time" in seconds or as "2019-06-01T00:00:00.000";
+ *  lines without it keep the previous action's time. Only top-level actions
+ *  may be given: replay runs their inline actions and notifications again,
+ *  so a trace of those would apply twice. convert rejects lines it can tell
+ *  are one: a "receiver" other than the account, or a non-zero
+ *  "creator_action_ordinal".
+ */
+
+#include <native/action_log.hpp>
+#include <native/checkpoint.hpp>
+#include <native/replay.hpp>
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace eosio;
+using namespace eosio::native;
+
+namespace
+{
+
+void usage()
+{
+   std::cerr <<
+      "usage: token_replay [options] <log>\n"
+      "       token_replay convert <actions.jsonl> <log>\n"
+      "\n"
+      "  convert takes top-level actions only, one per line; inline actions and\n"
+      "  notifications are replayed from them and must not be in the capture\n"
+      "\n"
+      "  --checkpoint-every N     write a checkpoint every N actions\n"
+      "  --checkpoint-dir DIR     where checkpoints go (.)\n"
+      "  --resume FILE            start from a checkpoint instead of an empty chain\n"
+      "  --final FILE             write a checkpoint of the final state\n"
+      "  --limit N                replay at most N actions\n"
+      "  --strict                 stop at the first failing action\n"
+      "  --contract ACCOUNT       account running the token contract (thepeostoken)\n"
+      "  --no-legacy-budgets      don't seed the pre-setvesting issuance budgets, for\n"
+      "                           captures that contain their own setvesting actions\n";
+}
+
+bool json_string(const std::string &line, size_t from, size_t to, const std::string &key, std::string &value)
+{
+   const auto quoted = "\"" + key + "\"";
+   auto pos = line.find(quoted, from);
+   if (pos == std::string::npos || pos >= to)
+   {
+      return false;
+   }
+   pos = line.find_first_not_of(" \t:", pos + quoted.size());
+   if (pos == std::string::npos)
+   {
+      return false;
+   }
+   if (line[pos] == '"')
+   {
+      auto end = line.find('"', pos + 1);
+      value = line.substr(pos + 1, end - pos - 1);
+   }
+   else
+   {
+      auto end = line.find_first_of(",}] \t\r", pos);
+      value = line.substr(pos, end - pos);
+   }
+   return true;
+}
+
+uint32_t parse_time(const std::string &text)
+{
+   if (text.find('T') == std::string::npos)
+   {
+      return uint32_t(std::stoul(text));
+   }
+   std::tm tm = {};
+   if (!strptime(text.c_str(), "%Y-%m-%dT%H:%M:%S", &tm))
+   {
+      throw std::runtime_error("invalid block_time " + text);
+   }
+   return uint32_t(timegm(&tm));
+}
+
+std::vector<char> parse_hex(const std::string &hex)
+{
+   if (hex.size() % 2)
+   {
+      throw std::runtime_error("odd-length hex data");
+   }
+   std::vector<char> bytes(hex.size() / 2);
+   for (size_t i = 0; i < bytes.size(); ++i)
+   {
+      bytes[i] = char(std::stoi(hex.substr(2 * i, 2), nullptr, 16));
+   }
+   return bytes;
+}
+
+int convert(const std::string &input, const std::string &output)
+{
+   std::ifstream in(input);
+   if (!in)
+   {
+      throw std::runtime_error("cannot open " + input);
+   }
+   action_log_writer log(output);
+
+   logged_action entry;
+   std::string line, value;
+   for (size_t number = 1; std::getline(in, line); ++number)
+   {
+      if (line.find_first_not_of(" \t\r") == std::string::npos)
+      {
+         continue;
+      }
+      try
+      {
+         if (json_string(line, 0, line.size(), "block_time", value))
+         {
+            entry.block_time = parse_time(value);
+         }
+
+         std::string account, act, data;
+         if (!json_string(line, 0, line.size(), "account", account) ||
+             !json_string(line, 0, line.size(), "name", act) || !json_string(line, 0, line.size(), "data", data))
+         {
+            throw std::runtime_error("missing account, name or data");
+         }
+         // replay re-runs what a top-level action sends; a trace of it would apply twice
+         std::string receiver, ordinal;
+         if (json_string(line, 0, line.size(), "receiver", receiver) && receiver != account)
+         {
+            throw std::runtime_error("notification of " + receiver + ", only top-level actions can be replayed");
+         }
+         if (json_string(line, 0, line.size(), "creator_action_ordinal", ordinal) && ordinal != "0")
+         {
+            throw std::runtime_error("inline action, only top-level actions can be replayed");
+         }
+
+         entry.act.account = name(account);
+         entry.act.name = name(act);
+         entry.act.data = parse_hex(data);
+
+         entry.act.authorization.clear();
+         const auto begin = line.find("\"authorization\"");
+         const auto end = begin == std::string::npos ? begin : line.find(']', begin);
+         for (auto pos = begin; pos != std::string::npos && pos < end;)
+         {
+            std::string actor, permission;
+            auto at = line.find("\"actor\"", pos);
+            if (at == std::string::npos || at >= end || !json_string(line, at, end, "actor", actor) ||
+                !json_string(line, at, end, "permission", permission))
+            {
+               break;
+            }
+            entry.act.authorization.push_back({name(actor), name(permission)});
+            pos = at + 1;
+         }
+
+         log.append(entry);
+      }
+      catch (const std::exception &e)
+      {
+         throw std::runtime_error(input + ":" + std::to_string(number) + ": " + e.what());
+      }
+   }
+   log.flush();
+
+   fprintf(stderr, "wrote %llu actions to %s\n", (unsigned long long)log.count(), output.c_str());
+   return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   try
+   {
+      if (argc == 4 && std::string(argv[1]) == "convert")
+      {
+         return convert(argv[2], argv[3]);
+      }
+
+      replay_options options;
+      std::string resume, final_checkpoint, path;
+      name contract("thepeostoken");
+      bool legacy_budgets = true;
+      for (int i = 1; i < argc; ++i)
+      {
+         std::string arg = argv[i];
+         auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+               throw std::runtime_error(arg + " needs a value");
+            }
+            return argv[++i];
+         };
+
+         if (arg == "--checkpoint-every")
+            options.checkpoint_interval = std::stoull(value());
+         else if (arg == "--checkpoint-dir")
+            options.checkpoint_dir = value();
+         else if (arg == "--resume")
+            resume = value();
+         else if (arg == "--final")
+            final_checkpoint = value();
+         else if (arg == "--limit")
+            options.limit = std::stoull(value());
+         else if (arg == "--strict")
+            options.stop_on_error = true;
+         else if (arg == "--contract")
+            contract = name(value());
+         else if (arg == "--no-legacy-budgets")
+            legacy_budgets = false;
+         else if (arg == "-h" || arg == "--help")
+         {
+            usage();
+            return 0;
+         }
+         else if (!arg.empty() && arg[0] == '-')
+            throw std::runtime_error("unknown option " + arg);
+         else
+            path = arg;
+      }
+      if (path.empty())
+      {
+         usage();
+         return 1;
+      }
+
+      replayer r(contract, legacy_budgets);
+      if (!resume.empty())
+      {
+         fprintf(stderr, "resuming after action %llu\n", (unsigned long long)r.resume(resume));
+      }
+
+      uint64_t reported = 0;
+      r.set_failure_hook([&](uint64_t position, const logged_action &entry, const std::exception &e) {
+         // the first few are enough to spot a systematic mismatch
+         if (reported++ < 10)
+         {
+            fprintf(stderr, "action %llu (%s::%s) failed: %s\n", (unsigned long long)position,
+                    entry.act.account.to_string().c_str(), entry.act.name.to_string().c_str(), e.what());
+         }
+      });
+
+      action_log_reader log(path);
+      const auto stats = r.replay(log, options);
+
+      if (!final_checkpoint.empty())
+      {
+         save_checkpoint(final_checkpoint, r.get_chain(), log.position());
+      }
+
+      printf("replayed %llu actions (%llu failed) in %.3f s: %.0f actions/s, %llu checkpoints\n",
+             (unsigned long long)(stats.applied + stats.failed), (unsigned long long)stats.failed, stats.seconds,
+             stats.actions_per_second(), (unsigned long long)stats.checkpoints);
+      return stats.failed ? 2 : 0;
+   }
+   catch (const std::exception &e)
+   {
+      fprintf(stderr, "token_replay: %s\n", e.what());
+      return 1;
+   }
+}
@@ -0,0 +1,168 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Drives token_fuzz where libFuzzer isn't available, e.g. with gcc: runs
+ *  each input given as a file or directory (a corpus, or a crash to
+ *  reproduce), or without any, random inputs.
+ *
+ *      token_fuzz [-runs=N] [-seed=N] [-max_len=N] [path...]
+ *
+ *  An input that aborts is written to token_fuzz-crash first. AFL can drive
+ *  the same binary built with afl-g++: afl-fuzz -i corpus -o out -- ./token_fuzz @@
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace
+{
+
+const uint8_t *current_data = nullptr;
+size_t current_size = 0;
+
+void save_crash(int sig)
+{
+   const int fd = open("token_fuzz-crash", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fd >= 0)
+   {
+      if (write(fd, current_data, current_size) < 0)
+      {
+         // nothing left to do in a signal handler
+      }
+      close(fd);
+   }
+   signal(sig, SIG_DFL);
+   raise(sig);
+}
+
+void run(const std::vector<uint8_t> &input)
+{
+   current_data = input.data();
+   current_size = input.size();
+   LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+
+std::vector<uint8_t> read_file(const std::string &path)
+{
+   std::ifstream in(path, std::ios::binary);
+   if (!in)
+   {
+      throw std::runtime_error("can't read " + path);
+   }
+   return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void run_path(const std::string &path)
+{
+   struct stat st;
+   if (stat(path.c_str(), &st) != 0)
+   {
+      throw std::runtime_error("can't read " + path);
+   }
+   if (!S_ISDIR(st.st_mode))
+   {
+      run(read_file(path));
+      return;
+   }
+
+   DIR *dir = opendir(path.c_str());
+   if (!dir)
+   {
+      throw std::runtime_error("can't read " + path);
+   }
+   std::vector<std::string> entries;
+   while (const dirent *entry = readdir(dir))
+   {
+      if (entry->d_name[0] != '.')
+      {
+         entries.push_back(path + "/" + entry->d_name);
+      }
+   }
+   closedir(dir);
+   for (const auto &entry : entries)
+   {
+      run_path(entry);
+   }
+}
+
+bool flag(const std::string &arg, const char *name, uint64_t &value)
+{
+   const auto prefix = std::string("-") + name + "=";
+   if (arg.compare(0, prefix.size(), prefix) != 0)
+   {
+      return false;
+   }
+   value = std::stoull(arg.substr(prefix.size()));
+   return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   try
+   {
+      uint64_t runs = 10000;
+      uint64_t seed = std::random_device{}();
+      uint64_t max_len = 1024;
+      std::vector<std::string> paths;
+      for (int i = 1; i < argc; ++i)
+      {
+         const std::string arg = argv[i];
+         if (flag(arg, "runs", runs) || flag(arg, "seed", seed) || flag(arg, "max_len", max_len))
+            continue;
+         else if (!arg.empty() && arg[0] == '-')
+            throw std::runtime_error("unknown option " + arg);
+         else
+            paths.push_back(arg);
+      }
+
+      signal(SIGABRT, save_crash);
+
+      if (!paths.empty())
+      {
+         for (const auto &path : paths)
+         {
+            run_path(path);
+         }
+         printf("token_fuzz: inputs passed\n");
+         return 0;
+      }
+
+      printf("token_fuzz: %llu random inputs, -seed=%llu\n", (unsigned long long)runs, (unsigned long long)seed);
+      std::mt19937_64 rng(seed);
+      std::vector<uint8_t> input;
+      for (uint64_t i = 0; i < runs; ++i)
+      {
+         input.resize(1 + rng() % std::max<uint64_t>(max_len, 1));
+         for (auto &byte : input)
+         {
+            byte = uint8_t(rng());
+         }
+         run(input);
+      }
+      printf("token_fuzz: done\n");
+      return 0;
+   }
+   catch (const std::exception &e)
+   {
+      fprintf(stderr, "token_fuzz: %s\n", e.what());
+      return 1;
+   }
+}
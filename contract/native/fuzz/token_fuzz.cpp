@@ -0,0 +1,634 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Fuzz target running the token through action sequences decoded from the
+ *  input: transfers, the staking state machine (stake, unstake, realizediv,
+ *  refund, procrefunds, distribute), issues, airdrop claims with good and
+ *  bad proofs and the UTXO actions with attacker-shaped inputs, outputs,
+ *  amounts and signatures, with time moving forward in between.
+ *
+ *  After every action:
+ *    - the ledger reconciles (see reconcile.hpp), so no token was created or
+ *      lost and the contract can pay everything it holds for others;
+ *    - the supply only changes by what issue added;
+ *    - each holder's balance + staked + refunding + pending dividends, as
+ *      getaccounts reports it, only moves the way the action says: staking
+ *      actions keep it, transfers move exactly the quantity, distribute only
+ *      adds to the other holders' dividends and UTXO actions only pay out;
+ *    - a claimed airdrop leaves the claimant's balance claimed;
+ *    - an action that fails leaves every row and RAM charge as it was.
+ *  A failed check() is expected; any other exception escaping an action is a
+ *  crash.
+ *
+ *  Linked with libFuzzer when built with clang, otherwise with the driver in
+ *  fuzz_main.cpp.
+ */
+
+#include <native/keys.hpp>
+#include <native/reconcile.hpp>
+#include <native/token_tester.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+using namespace eosio::native;
+
+namespace
+{
+
+constexpr size_t max_steps = 64;
+
+enum fuzz_op : uint8_t
+{
+   op_transfer,
+   op_stake,
+   op_unstake,
+   op_realizediv,
+   op_refund,
+   op_procrefunds,
+   op_distribute,
+   op_issue,
+   op_loadutxo,
+   op_transferutxo,
+   op_transferkeys,
+   op_sweeputxo,
+   op_advance,
+   op_claimdrop,
+   op_count
+};
+
+void fuzz_check(bool pred, const std::string &message)
+{
+   if (!pred)
+   {
+      fprintf(stderr, "token_fuzz: %s\n", message.c_str());
+      abort();
+   }
+}
+
+/// Reads the input front to back; once it runs out every value is zero.
+class fuzz_input
+{
+ public:
+   fuzz_input(const uint8_t *data, size_t size) : _data(data), _size(size) {}
+
+   bool empty() const { return _pos >= _size; }
+
+   template <typename T>
+   T take()
+   {
+      T value{};
+      const auto n = std::min(sizeof(T), _size - std::min(_pos, _size));
+      memcpy(&value, _data + _pos, n);
+      _pos += sizeof(T);
+      return value;
+   }
+
+   uint32_t pick(uint32_t count) { return take<uint8_t>() % count; }
+
+ private:
+   const uint8_t *_data;
+   size_t _size;
+   size_t _pos = 0;
+};
+
+const std::vector<private_key> &keys()
+{
+   static const std::vector<private_key> all = {private_key::from_seed("fuzz key 0"),
+                                                private_key::from_seed("fuzz key 1"),
+                                                private_key::from_seed("fuzz key 2")};
+   return all;
+}
+
+const private_key &key_of(const public_key &pk)
+{
+   for (const auto &key : keys())
+   {
+      if (key.get_public_key() == pk)
+      {
+         return key;
+      }
+   }
+   return keys().front();
+}
+
+using state = std::map<table_id, table>;
+
+/// Rows and payers equal, ignoring tables an undone emplace left empty.
+bool same_tables(const state &a, const state &b)
+{
+   auto ia = a.begin();
+   auto ib = b.begin();
+   for (;;)
+   {
+      while (ia != a.end() && ia->second.rows.empty())
+      {
+         ++ia;
+      }
+      while (ib != b.end() && ib->second.rows.empty())
+      {
+         ++ib;
+      }
+      if (ia == a.end() || ib == b.end())
+      {
+         return ia == a.end() && ib == b.end();
+      }
+      if (!(ia->first == ib->first) || ia->second.rows.size() != ib->second.rows.size())
+      {
+         return false;
+      }
+      for (auto ra = ia->second.rows.begin(), rb = ib->second.rows.begin(); ra != ia->second.rows.end(); ++ra, ++rb)
+      {
+         if (ra->first != rb->first || ra->second.payer != rb->second.payer || ra->second.value != rb->second.value ||
+             ra->second.secondary != rb->second.secondary)
+         {
+            return false;
+         }
+      }
+      ++ia;
+      ++ib;
+   }
+}
+
+bool same_ram(const std::map<uint64_t, int64_t> &a, const std::map<uint64_t, int64_t> &b)
+{
+   auto charged = [](const std::map<uint64_t, int64_t> &usage) {
+      std::map<uint64_t, int64_t> nonzero;
+      for (const auto &[payer, bytes] : usage)
+      {
+         if (bytes != 0)
+         {
+            nonzero.emplace(payer, bytes);
+         }
+      }
+      return nonzero;
+   };
+   return charged(a) == charged(b);
+}
+
+class fuzz_session
+{
+ public:
+   fuzz_session()
+   {
+      for (uint64_t i = 0; i < 4; ++i)
+      {
+         _holders.push_back(token_tester::account_name(i));
+         _t.create_account(_holders.back());
+         _t.fund(_holders.back(), token_tester::peos(1'000'0000));
+      }
+      publish_drop();
+      _holders.push_back(token_tester::marketing_account);
+   }
+
+   void run(fuzz_input &in)
+   {
+      auto values = holder_values();
+      for (size_t step = 0; step < max_steps && !in.empty(); ++step)
+      {
+         const auto op = fuzz_op(in.pick(op_count));
+         const auto supply = _t.supply().amount;
+         const auto tables = _t.get_chain().db().tables();
+         const auto ram = _t.get_chain().ram_usage();
+
+         _expect = {};
+         bool applied = true;
+         try
+         {
+            apply(op, in);
+         }
+         catch (const assert_exception &)
+         {
+            applied = false;
+         }
+         catch (const std::exception &e)
+         {
+            fuzz_check(false, "step " + std::to_string(step) + " escaped with " + e.what());
+         }
+
+         const auto context = "after step " + std::to_string(step) + " (op " + std::to_string(op) + ")";
+         if (!applied)
+         {
+            fuzz_check(same_tables(tables, _t.get_chain().db().tables()), "failed action changed rows " + context);
+            fuzz_check(same_ram(ram, _t.get_chain().ram_usage()), "failed action changed RAM " + context);
+            continue;
+         }
+
+         const auto ledger = _checker.check(_t.get_chain().db());
+         for (const auto &d : ledger.discrepancies)
+         {
+            fprintf(stderr, "  %s %s: %s\n", d.owner.to_string().c_str(), d.table.to_string().c_str(),
+                    d.message.c_str());
+         }
+         fuzz_check(ledger.ok(), "ledger doesn't reconcile " + context);
+         fuzz_check(_t.supply().amount == supply + _expect.issued, "supply moved " + context);
+
+         const auto after = holder_values();
+         check_values(values, after, context);
+         values = after;
+      }
+   }
+
+ private:
+   /// What a successful action may do to the holders' values.
+   struct expectation
+   {
+      enum
+      {
+         unchanged,
+         moved,
+         distributed,
+         paid_out
+      } kind = unchanged;
+      /// Exact changes of `moved`, or the distributor and its quantity.
+      std::map<uint64_t, int64_t> deltas;
+      int64_t issued = 0;
+   };
+
+   name holder(fuzz_input &in) { return _holders[in.pick(_holders.size())]; }
+
+   /// Airdrops (i + 1) * 10 PEOS to each of the four funded holders, from the issuer's balance.
+   void publish_drop()
+   {
+      std::vector<checksum256> leaves;
+      for (size_t i = 0; i < _holders.size(); ++i)
+      {
+         leaves.push_back(token_tester::drop_leaf_hash(_holders[i], drop_amount(i)));
+      }
+      const auto left = token_tester::drop_node_hash(leaves[0], leaves[1]);
+      const auto right = token_tester::drop_node_hash(leaves[2], leaves[3]);
+      for (size_t i = 0; i < _holders.size(); ++i)
+      {
+         _drop_proofs.push_back({leaves[i ^ 1], i < 2 ? right : left});
+      }
+      _t.issue(token_tester::contract_account, token_tester::peos(100'0000));
+      _t.setdroproot(token_tester::drop_node_hash(left, right));
+   }
+
+   static asset drop_amount(size_t i) { return token_tester::peos(int64_t(i + 1) * 10'0000); }
+
+   /// Mostly a holder, sometimes the contract or an account that doesn't exist.
+   name recipient(fuzz_input &in)
+   {
+      switch (in.pick(8))
+      {
+      case 0:
+         return token_tester::contract_account;
+      case 1:
+         return name(in.take<uint64_t>());
+      default:
+         return holder(in);
+      }
+   }
+
+   /// Mostly plausible PEOS amounts, sometimes zero, negative, out of range or of another precision.
+   asset quantity(fuzz_input &in)
+   {
+      asset q;
+      q.symbol = PEOS_SYMBOL;
+      switch (in.pick(8))
+      {
+      case 0:
+         q.amount = in.take<int64_t>();
+         break;
+      case 1:
+         q.amount = -int64_t(in.take<uint16_t>());
+         break;
+      case 2:
+         q.symbol = symbol("PEOS", 3);
+         q.amount = in.take<uint16_t>();
+         break;
+      default:
+         q.amount = int64_t(in.take<uint16_t>()) * int64_t(in.pick(4) == 0 ? 10'000 : 1);
+         break;
+      }
+      return q;
+   }
+
+   const private_key &key(fuzz_input &in) { return keys()[in.pick(keys().size())]; }
+
+   /// Mostly the owner's signature over the digest, sometimes another key's or another digest's.
+   signature sign(fuzz_input &in, const public_key &owner, const checksum256 &digest)
+   {
+      switch (in.pick(6))
+      {
+      case 0:
+         return key(in).sign(digest);
+      case 1:
+      {
+         auto other = digest.extract_as_byte_array();
+         other[in.pick(32)] ^= 1;
+         return key_of(owner).sign(checksum256(other));
+      }
+      default:
+         return key_of(owner).sign(digest);
+      }
+   }
+
+   std::vector<std::pair<uint64_t, public_key>> utxos()
+   {
+      std::vector<std::pair<uint64_t, public_key>> result;
+      const auto contract = token_tester::contract_account.value;
+      const auto &tables = _t.get_chain().db().tables();
+      auto itr = tables.find({contract, contract, "utxos"_n.value});
+      if (itr != tables.end())
+      {
+         for (const auto &[id, r] : itr->second.rows)
+         {
+            // utxo is (id, pk, amount)
+            result.push_back(unpack<std::pair<uint64_t, public_key>>(r.value));
+         }
+      }
+      return result;
+   }
+
+   /// An existing UTXO id most of the time, else any.
+   uint64_t utxo_id(fuzz_input &in, const std::vector<std::pair<uint64_t, public_key>> &existing)
+   {
+      if (existing.empty() || in.pick(8) == 0)
+      {
+         return in.take<uint8_t>();
+      }
+      return existing[in.pick(existing.size())].first;
+   }
+
+   std::vector<token::output> outputs(fuzz_input &in)
+   {
+      std::vector<token::output> result(in.pick(4));
+      for (auto &o : result)
+      {
+         if (in.pick(2))
+         {
+            o.pk = key(in).get_public_key();
+         }
+         else
+         {
+            o.account = recipient(in);
+         }
+         o.quantity = quantity(in);
+      }
+      return result;
+   }
+
+   void apply(fuzz_op op, fuzz_input &in)
+   {
+      switch (op)
+      {
+      case op_transfer:
+      {
+         const auto from = holder(in);
+         const auto to = recipient(in);
+         const auto q = quantity(in);
+         _t.transfer(from, to, q);
+         _expect.kind = expectation::moved;
+         _expect.deltas[from.value] -= q.amount;
+         _expect.deltas[to.value] += q.amount;
+         break;
+      }
+      case op_stake:
+      {
+         const auto owner = holder(in);
+         _t.stake(owner, quantity(in));
+         break;
+      }
+      case op_unstake:
+      {
+         const auto owner = holder(in);
+         _t.unstake(owner, quantity(in));
+         break;
+      }
+      case op_realizediv:
+         _t.realizediv(holder(in));
+         break;
+      case op_refund:
+         _t.refund(holder(in));
+         break;
+      case op_procrefunds:
+      {
+         const auto max = in.take<uint16_t>() % 600;
+         _t.procrefunds(max, holder(in));
+         break;
+      }
+      case op_distribute:
+      {
+         const auto owner = holder(in);
+         const auto q = quantity(in);
+         _t.distribute(owner, q);
+         _expect.kind = expectation::distributed;
+         _expect.deltas[owner.value] = q.amount;
+         break;
+      }
+      case op_issue:
+      {
+         const auto to = recipient(in);
+         const auto q = quantity(in);
+         _t.issue(to, q);
+         _expect.kind = expectation::moved;
+         _expect.deltas[to.value] += q.amount;
+         _expect.issued = q.amount;
+         break;
+      }
+      case op_loadutxo:
+      {
+         const auto from = holder(in);
+         const auto pk = key(in).get_public_key();
+         const auto q = quantity(in);
+         _t.loadutxo(from, pk, q);
+         _expect.kind = expectation::moved;
+         _expect.deltas[from.value] -= q.amount;
+         break;
+      }
+      case op_transferutxo:
+      {
+         const auto existing = utxos();
+         const auto payer = holder(in);
+         const auto outs = outputs(in);
+         std::vector<token::input> inputs(in.pick(4));
+         for (auto &input : inputs)
+         {
+            input.id = utxo_id(in, existing);
+            public_key owner;
+            for (const auto &[id, pk] : existing)
+            {
+               if (id == input.id)
+               {
+                  owner = pk;
+               }
+            }
+            input.sig = sign(in, owner, token_tester::utxo_digest(input.id, outs));
+         }
+         _t.transferutxo(payer, inputs, outs);
+         _expect.kind = expectation::paid_out;
+         break;
+      }
+      case op_transferkeys:
+      {
+         const auto existing = utxos();
+         const auto payer = holder(in);
+         const auto outs = outputs(in);
+         std::vector<token::keyinput> inputs(in.pick(3));
+         for (auto &input : inputs)
+         {
+            input.pk = key(in).get_public_key();
+            input.ids.resize(in.pick(4));
+            for (auto &id : input.ids)
+            {
+               id = utxo_id(in, existing);
+            }
+            input.sig = sign(in, input.pk, token_tester::utxo_key_digest(input.ids, outs));
+         }
+         _t.transferkeys(payer, inputs, outs);
+         _expect.kind = expectation::paid_out;
+         break;
+      }
+      case op_sweeputxo:
+      {
+         const auto existing = utxos();
+         const auto payer = holder(in);
+         const auto pk = key(in).get_public_key();
+         const uint32_t max = in.take<uint16_t>() % 520;
+         // sweeps start at the key's lowest id, which the signature covers
+         uint64_t first = in.take<uint8_t>();
+         for (auto itr = existing.rbegin(); itr != existing.rend(); ++itr)
+         {
+            if (itr->second == pk)
+            {
+               first = itr->first;
+            }
+         }
+         _t.sweeputxo(payer, pk, max, sign(in, pk, token_tester::utxo_sweep_digest(first, max)));
+         _expect.kind = expectation::paid_out;
+         break;
+      }
+      case op_claimdrop:
+      {
+         // mostly a holder's own allocation and proof, sometimes another amount or a damaged proof
+         const auto i = in.pick(_drop_proofs.size());
+         const auto owner = in.pick(4) ? _holders[i] : holder(in);
+         const auto q = in.pick(4) ? drop_amount(i) : quantity(in);
+         auto proof = _drop_proofs[i];
+         switch (in.pick(6))
+         {
+         case 0:
+            proof.pop_back();
+            break;
+         case 1:
+         {
+            auto bytes = proof.front().extract_as_byte_array();
+            bytes[in.pick(32)] ^= 1;
+            proof.front() = checksum256(bytes);
+            break;
+         }
+         default:
+            break;
+         }
+         _t.claimdrop(owner, q, proof);
+         _expect.kind = expectation::moved;
+         _expect.deltas[owner.value] += q.amount;
+         // otherwise recover could take the drop back
+         fuzz_check(_t.getaccounts({owner}).find("\"claimed\":true") != std::string::npos,
+                    "claimdrop left " + owner.to_string() + " unclaimed");
+         break;
+      }
+      case op_advance:
+      {
+         // up to about 10 days in hours, so refunds mature, or seconds
+         const uint32_t step = in.take<uint8_t>() * (in.pick(2) ? 3600 : 1);
+         _t.get_chain().set_time(_t.get_chain().time() + step);
+         break;
+      }
+      case op_count:
+         break;
+      }
+   }
+
+   /// balance + staked + refunding + pending dividends per holder, as getaccounts reports them.
+   std::vector<int64_t> holder_values()
+   {
+      const auto json = _t.getaccounts(_holders);
+      std::vector<int64_t> values;
+      size_t pos = 0;
+      for (size_t i = 0; i < _holders.size(); ++i)
+      {
+         int64_t value = 0;
+         for (const char *key : {"balance", "staked", "pending_dividends", "refunding"})
+         {
+            const auto quoted = std::string("\"") + key + "\":\"";
+            pos = json.find(quoted, pos);
+            fuzz_check(pos != std::string::npos, std::string("getaccounts printed no ") + key);
+            pos += quoted.size();
+
+            int64_t amount = 0;
+            const bool negative = json[pos] == '-';
+            for (pos += negative; json[pos] != ' '; ++pos)
+            {
+               if (json[pos] != '.')
+               {
+                  amount = amount * 10 + (json[pos] - '0');
+               }
+            }
+            value += negative ? -amount : amount;
+         }
+         values.push_back(value);
+      }
+      return values;
+   }
+
+   void check_values(const std::vector<int64_t> &before, const std::vector<int64_t> &after, const std::string &context)
+   {
+      int64_t total_before = 0;
+      int64_t total_after = 0;
+      for (size_t i = 0; i < _holders.size(); ++i)
+      {
+         const auto who = _holders[i].to_string() + " " + context;
+         const auto delta = _expect.deltas.count(_holders[i].value) ? _expect.deltas.at(_holders[i].value) : 0;
+         switch (_expect.kind)
+         {
+         case expectation::unchanged:
+            fuzz_check(after[i] == before[i], "value of " + who + " changed");
+            break;
+         case expectation::moved:
+            fuzz_check(after[i] == before[i] + delta, "value of " + who + " isn't moved by the quantity");
+            break;
+         case expectation::distributed:
+            // the distributor may earn back part of its own distribution
+            fuzz_check(after[i] >= before[i] - delta, "value of " + who + " lost more than the distribution");
+            fuzz_check(delta > 0 || after[i] >= before[i], "value of " + who + " dropped");
+            break;
+         case expectation::paid_out:
+            fuzz_check(after[i] >= before[i], "value of " + who + " dropped");
+            break;
+         }
+         total_before += before[i];
+         total_after += after[i];
+      }
+      if (_expect.kind == expectation::distributed)
+      {
+         // the distributor paid it all; floored dividends may catch up a unit each
+         fuzz_check(total_after <= total_before + int64_t(_holders.size()),
+                    "holders gained from a distribution " + context);
+      }
+   }
+
+   token_tester _t;
+   reconciler _checker;
+   std::vector<name> _holders;
+   std::vector<std::vector<checksum256>> _drop_proofs;
+   expectation _expect;
+};
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+   fuzz_input in(data, size);
+   fuzz_session session;
+   session.run(in);
+   return 0;
+}
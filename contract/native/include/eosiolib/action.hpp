@@ -0,0 +1,132 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's action API. Authorization, notification
+ *  and inline-action intrinsics are routed to the native chain harness.
+ */
+#pragma once
+
+#include <eosiolib/datastream.hpp>
+#include <eosiolib/name.hpp>
+
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio
+{
+
+struct permission_level
+{
+   permission_level(name a, name p) : actor(a), permission(p) {}
+   permission_level() {}
+
+   name actor;
+   name permission;
+
+   friend bool operator==(const permission_level &a, const permission_level &b)
+   {
+      return a.actor == b.actor && a.permission == b.permission;
+   }
+};
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const permission_level &v)
+{
+   return ds << v.actor << v.permission;
+}
+
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, permission_level &v)
+{
+   return ds >> v.actor >> v.permission;
+}
+
+struct action;
+
+namespace native
+{
+void send_inline(const action &act);
+void require_recipient(name notify_account);
+} // namespace native
+
+uint32_t read_action_data(void *msg, uint32_t len);
+uint32_t action_data_size();
+
+void require_auth(name n);
+void require_auth(const permission_level &level);
+bool has_auth(name n);
+bool is_account(name n);
+
+inline void require_recipient(name notify_account)
+{
+   native::require_recipient(notify_account);
+}
+
+template <typename... Accounts>
+void require_recipient(name notify_account, Accounts... remaining_accounts)
+{
+   native::require_recipient(notify_account);
+   require_recipient(remaining_accounts...);
+}
+
+struct action
+{
+   eosio::name account;
+   eosio::name name;
+   std::vector<permission_level> authorization;
+   std::vector<char> data;
+
+   action() = default;
+
+   template <typename T>
+   action(const permission_level &auth, struct name a, struct name n, T &&value)
+       : account(a), name(n), authorization(1, auth), data(pack(std::forward<T>(value))) {}
+
+   template <typename T>
+   action(std::vector<permission_level> auths, struct name a, struct name n, T &&value)
+       : account(a), name(n), authorization(std::move(auths)), data(pack(std::forward<T>(value))) {}
+
+   void send() const { native::send_inline(*this); }
+
+   template <typename T>
+   T data_as() const { return unpack<T>(data); }
+};
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const action &v)
+{
+   return ds << v.account << v.name << v.authorization << v.data;
+}
+
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, action &v)
+{
+   return ds >> v.account >> v.name >> v.authorization >> v.data;
+}
+
+template <typename, uint64_t>
+struct inline_dispatcher;
+
+template <typename T, uint64_t Name, typename... Args>
+struct inline_dispatcher<void (T::*)(Args...), Name>
+{
+   static void call(name code, const permission_level &perm, std::tuple<std::decay_t<Args>...> args)
+   {
+      action(perm, code, name(Name), std::move(args)).send();
+   }
+
+   static void call(name code, std::vector<permission_level> perms, std::tuple<std::decay_t<Args>...> args)
+   {
+      action(std::move(perms), code, name(Name), std::move(args)).send();
+   }
+};
+
+} // namespace eosio
+
+#define INLINE_ACTION_SENDER(CONTRACT_CLASS, NAME) \
+   ::eosio::inline_dispatcher<decltype(&CONTRACT_CLASS::NAME), ::eosio::name(#NAME).value>::call
+
+#define SEND_INLINE_ACTION(CONTRACT, NAME, ...) \
+   INLINE_ACTION_SENDER(std::decay_t<decltype(CONTRACT)>, NAME)((CONTRACT).get_self(), __VA_ARGS__);
@@ -0,0 +1,76 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's crypto intrinsics. sha256 and secp256k1
+ *  key recovery are real implementations, so signatures produced by wallets
+ *  (or by eosio::native::private_key) verify exactly as they would on chain.
+ */
+#pragma once
+
+#include <eosiolib/datastream.hpp>
+#include <eosiolib/fixed_bytes.hpp>
+#include <eosiolib/varint.hpp>
+
+#include <array>
+
+namespace eosio
+{
+
+struct public_key
+{
+   unsigned_int type;
+   std::array<char, 33> data;
+
+   friend bool operator==(const public_key &a, const public_key &b)
+   {
+      return a.type == b.type && a.data == b.data;
+   }
+   friend bool operator!=(const public_key &a, const public_key &b) { return !(a == b); }
+};
+
+struct signature
+{
+   unsigned_int type;
+   std::array<char, 65> data;
+
+   friend bool operator==(const signature &a, const signature &b)
+   {
+      return a.type == b.type && a.data == b.data;
+   }
+   friend bool operator!=(const signature &a, const signature &b) { return !(a == b); }
+};
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const public_key &v)
+{
+   return ds << v.type << v.data;
+}
+
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, public_key &v)
+{
+   return ds >> v.type >> v.data;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const signature &v)
+{
+   return ds << v.type << v.data;
+}
+
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, signature &v)
+{
+   return ds >> v.type >> v.data;
+}
+
+checksum256 sha256(const char *data, uint32_t length);
+
+void assert_sha256(const char *data, uint32_t length, const checksum256 &hash);
+
+public_key recover_key(const checksum256 &digest, const signature &sig);
+
+void assert_recover_key(const checksum256 &digest, const signature &sig, const public_key &pubkey);
+
+} // namespace eosio
@@ -0,0 +1,462 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's datastream and pack/unpack. Aggregates
+ *  without an explicit serializer are reflected field by field, the way the
+ *  cdt serializes [[eosio::table]] and action argument structs.
+ */
+#pragma once
+
+#include <eosiolib/fixed_bytes.hpp>
+#include <eosiolib/name.hpp>
+#include <eosiolib/symbol.hpp>
+#include <eosiolib/system.hpp>
+#include <eosiolib/varint.hpp>
+
+#include <array>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace eosio
+{
+
+template <typename T>
+class datastream
+{
+ public:
+   datastream(T start, size_t s) : _start(start), _pos(start), _end(start + s) {}
+
+   inline void skip(size_t s) { _pos += s; }
+
+   inline bool read(char *d, size_t s)
+   {
+      check(size_t(_end - _pos) >= s, "datastream attempted to read past the end");
+      memcpy(d, _pos, s);
+      _pos += s;
+      return true;
+   }
+
+   inline bool write(const char *d, size_t s)
+   {
+      check(size_t(_end - _pos) >= s, "datastream attempted to write past the end");
+      memcpy((void *)_pos, d, s);
+      _pos += s;
+      return true;
+   }
+
+   inline bool put(char c)
+   {
+      check(_pos < _end, "put");
+      *_pos++ = c;
+      return true;
+   }
+
+   inline bool get(unsigned char &c) { return get(*(char *)&c); }
+
+   inline bool get(char &c)
+   {
+      check(_pos < _end, "get");
+      c = *_pos++;
+      return true;
+   }
+
+   T pos() const { return _pos; }
+   inline bool valid() const { return _pos <= _end && _pos >= _start; }
+
+   inline bool seekp(size_t p)
+   {
+      _pos = _start + p;
+      return _pos <= _end;
+   }
+
+   inline size_t tellp() const { return size_t(_pos - _start); }
+   inline size_t remaining() const { return _end - _pos; }
+
+ private:
+   T _start;
+   T _pos;
+   T _end;
+};
+
+template <>
+class datastream<size_t>
+{
+ public:
+   datastream(size_t init_size = 0) : _size(init_size) {}
+
+   inline bool skip(size_t s)
+   {
+      _size += s;
+      return true;
+   }
+   inline bool write(const char *, size_t s)
+   {
+      _size += s;
+      return true;
+   }
+   inline bool put(char)
+   {
+      ++_size;
+      return true;
+   }
+   inline bool valid() const { return true; }
+   inline bool seekp(size_t p)
+   {
+      _size = p;
+      return true;
+   }
+   inline size_t tellp() const { return _size; }
+   inline size_t remaining() const { return 0; }
+
+ private:
+   size_t _size;
+};
+
+namespace _datastream_detail
+{
+
+template <typename T>
+constexpr bool is_primitive()
+{
+   return std::is_arithmetic<T>::value || std::is_same<T, uint128_t>::value || std::is_same<T, int128_t>::value;
+}
+
+/// Converts to any field type; used to count the fields of an aggregate.
+struct ubiq
+{
+   template <typename T>
+   constexpr operator T &() const noexcept;
+};
+
+template <typename T, typename Seq, typename = void>
+struct braces_constructible : std::false_type
+{
+};
+
+template <typename T, size_t... I>
+struct braces_constructible<T, std::index_sequence<I...>, std::void_t<decltype(T{(void(I), ubiq{})...})>>
+    : std::true_type
+{
+};
+
+template <typename T, size_t N = 0>
+constexpr size_t field_count()
+{
+   if constexpr (braces_constructible<T, std::make_index_sequence<N + 1>>::value)
+      return field_count<T, N + 1>();
+   else
+      return N;
+}
+
+template <typename T, typename F>
+void for_each_field(T &&t, F &&f)
+{
+   constexpr size_t n = field_count<std::decay_t<T>>();
+   static_assert(n <= 12, "reflected serialization supports up to 12 fields");
+   static_assert(n > 0, "type cannot be reflected; give it an explicit serializer");
+
+   if constexpr (n == 1)
+   {
+      auto &[a] = t;
+      f(a);
+   }
+   else if constexpr (n == 2)
+   {
+      auto &[a, b] = t;
+      f(a), f(b);
+   }
+   else if constexpr (n == 3)
+   {
+      auto &[a, b, c] = t;
+      f(a), f(b), f(c);
+   }
+   else if constexpr (n == 4)
+   {
+      auto &[a, b, c, d] = t;
+      f(a), f(b), f(c), f(d);
+   }
+   else if constexpr (n == 5)
+   {
+      auto &[a, b, c, d, e] = t;
+      f(a), f(b), f(c), f(d), f(e);
+   }
+   else if constexpr (n == 6)
+   {
+      auto &[a, b, c, d, e, g] = t;
+      f(a), f(b), f(c), f(d), f(e), f(g);
+   }
+   else if constexpr (n == 7)
+   {
+      auto &[a, b, c, d, e, g, h] = t;
+      f(a), f(b), f(c), f(d), f(e), f(g), f(h);
+   }
+   else if constexpr (n == 8)
+   {
+      auto &[a, b, c, d, e, g, h, i] = t;
+      f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i);
+   }
+   else if constexpr (n == 9)
+   {
+      auto &[a, b, c, d, e, g, h, i, j] = t;
+      f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i), f(j);
+   }
+   else if constexpr (n == 10)
+   {
+      auto &[a, b, c, d, e, g, h, i, j, k] = t;
+      f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i), f(j), f(k);
+   }
+   else if constexpr (n == 11)
+   {
+      auto &[a, b, c, d, e, g, h, i, j, k, l] = t;
+      f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i), f(j), f(k), f(l);
+   }
+   else if constexpr (n == 12)
+   {
+      auto &[a, b, c, d, e, g, h, i, j, k, l, m] = t;
+      f(a), f(b), f(c), f(d), f(e), f(g), f(h), f(i), f(j), f(k), f(l), f(m);
+   }
+}
+
+template <typename T>
+struct is_std_array : std::false_type
+{
+};
+
+template <typename T, size_t N>
+struct is_std_array<std::array<T, N>> : std::true_type
+{
+};
+
+template <typename T>
+constexpr bool is_reflected()
+{
+   return std::is_class<T>::value && std::is_aggregate<T>::value && !is_std_array<T>::value;
+}
+
+} // namespace _datastream_detail
+
+template <typename Stream, typename T, std::enable_if_t<_datastream_detail::is_primitive<T>()> * = nullptr>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const T &v)
+{
+   ds.write((const char *)&v, sizeof(T));
+   return ds;
+}
+
+template <typename Stream, typename T, std::enable_if_t<_datastream_detail::is_primitive<T>()> * = nullptr>
+datastream<Stream> &operator>>(datastream<Stream> &ds, T &v)
+{
+   ds.read((char *)&v, sizeof(T));
+   return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const name &v)
+{
+   return ds << v.value;
+}
+
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, name &v)
+{
+   return ds >> v.value;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const symbol_code &v)
+{
+   return ds << v.raw();
+}
+
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, symbol_code &v)
+{
+   uint64_t raw = 0;
+   ds >> raw;
+   v = symbol_code(raw);
+   return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const symbol &v)
+{
+   return ds << v.raw();
+}
+
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, symbol &v)
+{
+   uint64_t raw = 0;
+   ds >> raw;
+   v = symbol(raw);
+   return ds;
+}
+
+template <typename Stream, size_t Size>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const fixed_bytes<Size> &d)
+{
+   auto arr = d.extract_as_byte_array();
+   ds.write((const char *)arr.data(), arr.size());
+   return ds;
+}
+
+template <typename Stream, size_t Size>
+datastream<Stream> &operator>>(datastream<Stream> &ds, fixed_bytes<Size> &d)
+{
+   std::array<uint8_t, Size> arr;
+   ds.read((char *)arr.data(), arr.size());
+   d = fixed_bytes<Size>(arr);
+   return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const std::string &v)
+{
+   ds << unsigned_int(v.size());
+   if (v.size())
+      ds.write(v.data(), v.size());
+   return ds;
+}
+
+template <typename Stream>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::string &v)
+{
+   unsigned_int s;
+   ds >> s;
+   v.resize(s.value);
+   if (s.value)
+      ds.read(&v[0], s.value);
+   return ds;
+}
+
+template <typename Stream, typename T, size_t N>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const std::array<T, N> &v)
+{
+   for (const auto &i : v)
+      ds << i;
+   return ds;
+}
+
+template <typename Stream, typename T, size_t N>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::array<T, N> &v)
+{
+   for (auto &i : v)
+      ds >> i;
+   return ds;
+}
+
+template <typename Stream, typename T>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const std::vector<T> &v)
+{
+   ds << unsigned_int(v.size());
+   if constexpr (std::is_same<T, char>::value)
+   {
+      if (v.size())
+         ds.write(v.data(), v.size());
+   }
+   else
+   {
+      for (const auto &i : v)
+         ds << i;
+   }
+   return ds;
+}
+
+template <typename Stream, typename T>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::vector<T> &v)
+{
+   unsigned_int s;
+   ds >> s;
+   v.resize(s.value);
+   if constexpr (std::is_same<T, char>::value)
+   {
+      if (s.value)
+         ds.read(v.data(), s.value);
+   }
+   else
+   {
+      for (auto &i : v)
+         ds >> i;
+   }
+   return ds;
+}
+
+template <typename Stream, typename A, typename B>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const std::pair<A, B> &v)
+{
+   return ds << v.first << v.second;
+}
+
+template <typename Stream, typename A, typename B>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::pair<A, B> &v)
+{
+   return ds >> v.first >> v.second;
+}
+
+template <typename Stream, typename... Args>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const std::tuple<Args...> &t)
+{
+   std::apply([&](const auto &... a) { (void)(ds << ... << a); }, t);
+   return ds;
+}
+
+template <typename Stream, typename... Args>
+datastream<Stream> &operator>>(datastream<Stream> &ds, std::tuple<Args...> &t)
+{
+   std::apply([&](auto &... a) { (void)(ds >> ... >> a); }, t);
+   return ds;
+}
+
+template <typename Stream, typename T, std::enable_if_t<_datastream_detail::is_reflected<T>()> * = nullptr>
+datastream<Stream> &operator<<(datastream<Stream> &ds, const T &v)
+{
+   _datastream_detail::for_each_field(v, [&](const auto &f) { ds << f; });
+   return ds;
+}
+
+template <typename Stream, typename T, std::enable_if_t<_datastream_detail::is_reflected<T>()> * = nullptr>
+datastream<Stream> &operator>>(datastream<Stream> &ds, T &v)
+{
+   _datastream_detail::for_each_field(v, [&](auto &f) { ds >> f; });
+   return ds;
+}
+
+template <typename T>
+size_t pack_size(const T &value)
+{
+   datastream<size_t> ps;
+   ps << value;
+   return ps.tellp();
+}
+
+template <typename T>
+std::vector<char> pack(const T &value)
+{
+   std::vector<char> result;
+   result.resize(pack_size(value));
+
+   datastream<char *> ds(result.data(), result.size());
+   ds << value;
+   return result;
+}
+
+template <typename T>
+T unpack(const char *buffer, size_t len)
+{
+   T result;
+   datastream<const char *> ds(buffer, len);
+   ds >> result;
+   return result;
+}
+
+template <typename T>
+T unpack(const std::vector<char> &bytes)
+{
+   return unpack<T>(bytes.data(), bytes.size());
+}
+
+} // namespace eosio
@@ -0,0 +1,67 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's action dispatcher. EOSIO_DISPATCH
+ *  defines the same extern "C" apply() entry point the wasm build exports;
+ *  the native harness calls it directly.
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
+#include <eosiolib/contract.hpp>
+#include <eosiolib/datastream.hpp>
+
+#include <boost/preprocessor/seq/for_each.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio
+{
+
+template <typename T, typename... Args>
+bool execute_action(name self, name code, void (T::*func)(Args...))
+{
+   size_t size = action_data_size();
+   std::vector<char> buffer(size);
+   if (size > 0)
+   {
+      read_action_data(buffer.data(), size);
+   }
+
+   std::tuple<std::decay_t<Args>...> args;
+   datastream<const char *> ds(buffer.data(), size);
+   ds >> args;
+
+   T inst(self, code, ds);
+   std::apply([&](auto &... a) { (inst.*func)(a...); }, args);
+   return true;
+}
+
+} // namespace eosio
+
+#define EOSIO_DISPATCH_INTERNAL(r, OP, elem)                                               \
+   case eosio::name(BOOST_PP_STRINGIZE(elem)).value:                                       \
+      eosio::execute_action(eosio::name(receiver), eosio::name(code), &OP::elem); \
+      break;
+
+#define EOSIO_DISPATCH_HELPER(TYPE, MEMBERS) \
+   BOOST_PP_SEQ_FOR_EACH(EOSIO_DISPATCH_INTERNAL, TYPE, MEMBERS)
+
+#define EOSIO_DISPATCH(TYPE, MEMBERS)                                 \
+   extern "C"                                                         \
+   {                                                                  \
+      void apply(uint64_t receiver, uint64_t code, uint64_t action)   \
+      {                                                               \
+         if (code == receiver)                                        \
+         {                                                            \
+            switch (action)                                           \
+            {                                                         \
+               EOSIO_DISPATCH_HELPER(TYPE, MEMBERS)                   \
+            }                                                         \
+         }                                                            \
+      }                                                               \
+   }
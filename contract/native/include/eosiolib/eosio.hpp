@@ -0,0 +1,15 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's umbrella header.
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
+#include <eosiolib/contract.hpp>
+#include <eosiolib/dispatcher.hpp>
+#include <eosiolib/multi_index.hpp>
+#include <eosiolib/name.hpp>
+#include <eosiolib/print.hpp>
+#include <eosiolib/system.hpp>
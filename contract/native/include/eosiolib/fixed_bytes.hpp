@@ -0,0 +1,104 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's fixed_bytes. The in-memory layout
+ *  matches cdt 1.5 (big-endian bytes packed into 128-bit words) so that code
+ *  hashing a checksum256 by address sees the same bytes as on chain. The
+ *  words are kept as their byte image, without 16-byte alignment, because
+ *  the contract embeds checksums in #pragma pack(1) structs (sign_data).
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace eosio
+{
+
+using uint128_t = unsigned __int128;
+using int128_t = __int128;
+
+template <size_t Size>
+class fixed_bytes
+{
+ public:
+   using word_t = uint128_t;
+
+   static constexpr size_t num_words() { return (Size + sizeof(word_t) - 1) / sizeof(word_t); }
+   static constexpr size_t padded_bytes() { return num_words() * sizeof(word_t) - Size; }
+
+   fixed_bytes() : _data() {}
+
+   fixed_bytes(const std::array<word_t, num_words()> &arr) { memcpy(_data, arr.data(), sizeof(_data)); }
+
+   fixed_bytes(const std::array<uint8_t, Size> &arr) { set_from_bytes(arr.data()); }
+
+   fixed_bytes(const uint8_t (&arr)[Size]) { set_from_bytes(arr); }
+
+   static constexpr size_t size() { return Size; }
+
+   std::array<word_t, num_words()> get_array() const
+   {
+      std::array<word_t, num_words()> arr;
+      memcpy(arr.data(), _data, sizeof(_data));
+      return arr;
+   }
+
+   std::array<uint8_t, Size> extract_as_byte_array() const
+   {
+      std::array<uint8_t, Size> arr;
+      size_t out = 0;
+      for (size_t w = 0; w < num_words(); ++w)
+      {
+         const size_t skip = (w == 0) ? padded_bytes() : 0;
+         for (size_t b = skip; b < sizeof(word_t); ++b)
+         {
+            arr[out++] = uint8_t(word(w) >> (8 * (sizeof(word_t) - 1 - b)));
+         }
+      }
+      return arr;
+   }
+
+   friend bool operator==(const fixed_bytes &a, const fixed_bytes &b)
+   {
+      return memcmp(a._data, b._data, sizeof(_data)) == 0;
+   }
+   friend bool operator!=(const fixed_bytes &a, const fixed_bytes &b) { return !(a == b); }
+   friend bool operator<(const fixed_bytes &a, const fixed_bytes &b) { return a.get_array() < b.get_array(); }
+   friend bool operator<=(const fixed_bytes &a, const fixed_bytes &b) { return a.get_array() <= b.get_array(); }
+   friend bool operator>(const fixed_bytes &a, const fixed_bytes &b) { return a.get_array() > b.get_array(); }
+   friend bool operator>=(const fixed_bytes &a, const fixed_bytes &b) { return a.get_array() >= b.get_array(); }
+
+ private:
+   word_t word(size_t w) const
+   {
+      word_t value;
+      memcpy(&value, _data + w * sizeof(word_t), sizeof(word_t));
+      return value;
+   }
+
+   void set_from_bytes(const uint8_t *bytes)
+   {
+      size_t in = 0;
+      for (size_t w = 0; w < num_words(); ++w)
+      {
+         const size_t skip = (w == 0) ? padded_bytes() : 0;
+         word_t value = 0;
+         for (size_t b = skip; b < sizeof(word_t); ++b)
+         {
+            value = (value << 8) | bytes[in++];
+         }
+         memcpy(_data + w * sizeof(word_t), &value, sizeof(word_t));
+      }
+   }
+
+   uint8_t _data[num_words() * sizeof(word_t)];
+};
+
+using checksum160 = fixed_bytes<20>;
+using checksum256 = fixed_bytes<32>;
+using checksum512 = fixed_bytes<64>;
+
+} // namespace eosio
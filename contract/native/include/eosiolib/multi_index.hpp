@@ -0,0 +1,491 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's eosio::multi_index on top of the
+ *  in-memory native::database. Like the real container, each instance keeps
+ *  its own cache of deserialized objects, so references returned by get()
+ *  and iterator dereferences stay valid for the lifetime of the instance.
+ */
+#pragma once
+
+#include <eosiolib/datastream.hpp>
+#include <eosiolib/name.hpp>
+#include <eosiolib/system.hpp>
+#include <native/database.hpp>
+
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace eosio
+{
+
+constexpr static inline name same_payer{};
+
+template <name::raw IndexName, typename Extractor>
+struct indexed_by
+{
+   enum constants
+   {
+      index_name = static_cast<uint64_t>(IndexName)
+   };
+   typedef Extractor secondary_extractor_type;
+};
+
+template <class Class, typename Type, Type (Class::*PtrToMemberFunction)() const>
+struct const_mem_fun
+{
+   typedef typename std::remove_reference<Type>::type result_type;
+
+   Type operator()(const Class &x) const { return (x.*PtrToMemberFunction)(); }
+};
+
+template <name::raw TableName, typename T, typename... Indices>
+class multi_index
+{
+ public:
+   class const_iterator
+   {
+      friend class multi_index;
+
+    public:
+      using iterator_category = std::bidirectional_iterator_tag;
+      using value_type = const T;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const T *;
+      using reference = const T &;
+
+      const_iterator() = default;
+
+      const T &operator*() const { return _multidx->load(_pk); }
+      const T *operator->() const { return &_multidx->load(_pk); }
+
+      const_iterator &operator++()
+      {
+         check(!_end, "cannot increment end iterator");
+         auto tbl = _multidx->table();
+         auto itr = tbl->rows.upper_bound(_pk);
+         set(itr == tbl->rows.end() ? std::optional<uint64_t>() : itr->first);
+         return *this;
+      }
+
+      const_iterator operator++(int)
+      {
+         auto tmp = *this;
+         ++(*this);
+         return tmp;
+      }
+
+      const_iterator &operator--()
+      {
+         auto tbl = _multidx->table();
+         check(tbl && !tbl->rows.empty(), "cannot decrement end iterator when the table is empty");
+         auto itr = _end ? tbl->rows.end() : tbl->rows.lower_bound(_pk);
+         check(itr != tbl->rows.begin(), "cannot decrement iterator at beginning of table");
+         --itr;
+         set(itr->first);
+         return *this;
+      }
+
+      const_iterator operator--(int)
+      {
+         auto tmp = *this;
+         --(*this);
+         return tmp;
+      }
+
+      friend bool operator==(const const_iterator &a, const const_iterator &b)
+      {
+         return a._end == b._end && (a._end || a._pk == b._pk);
+      }
+      friend bool operator!=(const const_iterator &a, const const_iterator &b) { return !(a == b); }
+
+    private:
+      const_iterator(const multi_index *idx, std::optional<uint64_t> pk) : _multidx(idx) { set(pk); }
+
+      void set(std::optional<uint64_t> pk)
+      {
+         _end = !pk;
+         _pk = pk ? *pk : 0;
+      }
+
+      const multi_index *_multidx = nullptr;
+      uint64_t _pk = 0;
+      bool _end = true;
+   };
+
+   multi_index(name code, uint64_t scope) : _code(code), _scope(scope) {}
+
+   multi_index(const multi_index &) = delete;
+   multi_index &operator=(const multi_index &) = delete;
+
+   name get_code() const { return _code; }
+   uint64_t get_scope() const { return _scope; }
+
+   const_iterator cbegin() const
+   {
+      auto tbl = table();
+      if (!tbl || tbl->rows.empty())
+      {
+         return end();
+      }
+      return const_iterator(this, tbl->rows.begin()->first);
+   }
+
+   const_iterator begin() const { return cbegin(); }
+   const_iterator cend() const { return const_iterator(this, std::nullopt); }
+   const_iterator end() const { return cend(); }
+
+   const_iterator lower_bound(uint64_t primary) const
+   {
+      auto tbl = table();
+      if (!tbl)
+      {
+         return end();
+      }
+      auto itr = tbl->rows.lower_bound(primary);
+      return itr == tbl->rows.end() ? end() : const_iterator(this, itr->first);
+   }
+
+   const_iterator upper_bound(uint64_t primary) const
+   {
+      auto tbl = table();
+      if (!tbl)
+      {
+         return end();
+      }
+      auto itr = tbl->rows.upper_bound(primary);
+      return itr == tbl->rows.end() ? end() : const_iterator(this, itr->first);
+   }
+
+   uint64_t available_primary_key() const
+   {
+      auto tbl = table();
+      if (!tbl || tbl->rows.empty())
+      {
+         return 0;
+      }
+      auto last = tbl->rows.rbegin()->first;
+      check(last < std::numeric_limits<uint64_t>::max() - 1, "next primary key in table is at autoincrement limit");
+      return last + 1;
+   }
+
+   const_iterator find(uint64_t primary) const
+   {
+      if (_objects.count(primary))
+      {
+         return const_iterator(this, primary);
+      }
+      if (!native::db().find(id(), primary))
+      {
+         return end();
+      }
+      return const_iterator(this, primary);
+   }
+
+   const_iterator require_find(uint64_t primary, const char *error_msg = "unable to find key") const
+   {
+      auto itr = find(primary);
+      check(itr != end(), error_msg);
+      return itr;
+   }
+
+   const T &get(uint64_t primary, const char *error_msg = "unable to find key") const
+   {
+      auto itr = find(primary);
+      check(itr != end(), error_msg);
+      return *itr;
+   }
+
+   const_iterator iterator_to(const T &obj) const
+   {
+      return const_iterator(this, obj.primary_key());
+   }
+
+   template <typename Lambda>
+   const_iterator emplace(name payer, Lambda &&constructor)
+   {
+      check(_code.value == native::current_receiver(), "cannot create objects in table of another contract");
+
+      auto obj = std::make_unique<T>();
+      constructor(*obj);
+
+      const uint64_t pk = obj->primary_key();
+      check(!native::db().find(id(), pk), "could not insert object, most likely a uniqueness constraint was violated");
+
+      native::db().emplace(id(), pk, native::row{payer.value, pack(*obj), secondary_keys(*obj)});
+      _objects[pk] = std::move(obj);
+      return const_iterator(this, pk);
+   }
+
+   template <typename Lambda>
+   void modify(const_iterator itr, name payer, Lambda &&updater)
+   {
+      check(itr != end(), "cannot pass end iterator to modify");
+      modify(*itr, payer, std::forward<Lambda>(updater));
+   }
+
+   template <typename Lambda>
+   void modify(const T &obj, name payer, Lambda &&updater)
+   {
+      check(_code.value == native::current_receiver(), "cannot modify objects in table of another contract");
+
+      const uint64_t pk = obj.primary_key();
+      auto cached = _objects.find(pk);
+      check(cached != _objects.end() && cached->second.get() == &obj,
+            "object passed to modify is not in multi_index");
+
+      auto &mutableobj = *cached->second;
+      updater(mutableobj);
+      check(pk == mutableobj.primary_key(), "updater cannot change primary key when modifying an object");
+
+      const auto *existing = native::db().find(id(), pk);
+      check(existing != nullptr, "object passed to modify no longer exists");
+      const uint64_t new_payer = payer.value ? payer.value : existing->payer;
+
+      native::db().modify(id(), pk, new_payer, pack(mutableobj), secondary_keys(mutableobj));
+   }
+
+   const_iterator erase(const_iterator itr)
+   {
+      check(itr != end(), "cannot pass end iterator to erase");
+      auto next = itr;
+      ++next;
+      erase(*itr);
+      return next;
+   }
+
+   void erase(const T &obj)
+   {
+      check(_code.value == native::current_receiver(), "cannot erase objects in table of another contract");
+
+      const uint64_t pk = obj.primary_key();
+      check(native::db().find(id(), pk) != nullptr, "attempt to remove object that was not in multi_index");
+
+      native::db().erase(id(), pk);
+      _objects.erase(pk);
+   }
+
+   template <name::raw IndexName>
+   auto get_index() const
+   {
+      constexpr size_t number = index_number<static_cast<uint64_t>(IndexName), 0, Indices...>();
+      using index_type = typename std::tuple_element<number, std::tuple<Indices...>>::type;
+      return secondary_index<static_cast<uint64_t>(IndexName), typename index_type::secondary_extractor_type, number>(this);
+   }
+
+   template <uint64_t IndexName, typename Extractor, size_t Number>
+   class secondary_index
+   {
+    public:
+      using secondary_key_type = std::decay_t<decltype(Extractor()(std::declval<const T &>()))>;
+
+      class const_iterator
+      {
+         friend class secondary_index;
+
+       public:
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type = const T;
+         using difference_type = std::ptrdiff_t;
+         using pointer = const T *;
+         using reference = const T &;
+
+         const_iterator() = default;
+
+         const T &operator*() const { return _idx->_multidx->load(_entry.second); }
+         const T *operator->() const { return &_idx->_multidx->load(_entry.second); }
+
+         const_iterator &operator++()
+         {
+            check(!_end, "cannot increment end iterator");
+            auto &keys = _idx->keys();
+            auto itr = keys.upper_bound(_entry);
+            set(itr == keys.end() ? std::optional<native::secondary_entry>() : *itr);
+            return *this;
+         }
+
+         const_iterator operator++(int)
+         {
+            auto tmp = *this;
+            ++(*this);
+            return tmp;
+         }
+
+         const_iterator &operator--()
+         {
+            auto &keys = _idx->keys();
+            check(!keys.empty(), "cannot decrement end iterator when the index is empty");
+            auto itr = _end ? keys.end() : keys.lower_bound(_entry);
+            check(itr != keys.begin(), "cannot decrement iterator at beginning of index");
+            --itr;
+            set(*itr);
+            return *this;
+         }
+
+         friend bool operator==(const const_iterator &a, const const_iterator &b)
+         {
+            return a._end == b._end && (a._end || a._entry == b._entry);
+         }
+         friend bool operator!=(const const_iterator &a, const const_iterator &b) { return !(a == b); }
+
+       private:
+         const_iterator(const secondary_index *idx, std::optional<native::secondary_entry> entry) : _idx(idx)
+         {
+            set(std::move(entry));
+         }
+
+         void set(std::optional<native::secondary_entry> entry)
+         {
+            _end = !entry;
+            if (entry)
+            {
+               _entry = std::move(*entry);
+            }
+         }
+
+         const secondary_index *_idx = nullptr;
+         native::secondary_entry _entry;
+         bool _end = true;
+      };
+
+      explicit secondary_index(const multi_index *idx) : _multidx(idx) {}
+
+      static constexpr uint64_t name() { return IndexName; }
+
+      const_iterator cbegin() const
+      {
+         auto &k = keys();
+         return k.empty() ? end() : const_iterator(this, *k.begin());
+      }
+      const_iterator begin() const { return cbegin(); }
+      const_iterator cend() const { return const_iterator(this, std::nullopt); }
+      const_iterator end() const { return cend(); }
+
+      const_iterator lower_bound(const secondary_key_type &secondary) const
+      {
+         auto &k = keys();
+         auto itr = k.lower_bound({native::to_secondary_key(secondary), 0});
+         return itr == k.end() ? end() : const_iterator(this, *itr);
+      }
+
+      const_iterator upper_bound(const secondary_key_type &secondary) const
+      {
+         auto &k = keys();
+         auto itr = k.upper_bound({native::to_secondary_key(secondary), std::numeric_limits<uint64_t>::max()});
+         return itr == k.end() ? end() : const_iterator(this, *itr);
+      }
+
+      const_iterator find(const secondary_key_type &secondary) const
+      {
+         auto itr = lower_bound(secondary);
+         if (itr == end() || itr._entry.first != native::to_secondary_key(secondary))
+         {
+            return end();
+         }
+         return itr;
+      }
+
+      const T &get(const secondary_key_type &secondary, const char *error_msg = "unable to find secondary key") const
+      {
+         auto itr = find(secondary);
+         check(itr != end(), error_msg);
+         return *itr;
+      }
+
+      const_iterator iterator_to(const T &obj) const
+      {
+         return const_iterator(this, native::secondary_entry{key_of(obj), obj.primary_key()});
+      }
+
+      template <typename Lambda>
+      void modify(const_iterator itr, eosio::name payer, Lambda &&updater)
+      {
+         check(itr != end(), "cannot pass end iterator to modify");
+         const_cast<multi_index *>(_multidx)->modify(*itr, payer, std::forward<Lambda>(updater));
+      }
+
+      const_iterator erase(const_iterator itr)
+      {
+         check(itr != end(), "cannot pass end iterator to erase");
+         auto next = itr;
+         ++next;
+         const_cast<multi_index *>(_multidx)->erase(*itr);
+         return next;
+      }
+
+    private:
+      friend class multi_index;
+
+      static std::string key_of(const T &obj) { return native::to_secondary_key(Extractor()(obj)); }
+
+      const std::set<native::secondary_entry> &keys() const
+      {
+         static const std::set<native::secondary_entry> empty;
+         auto tbl = _multidx->table();
+         if (!tbl || tbl->indices.size() <= Number)
+         {
+            return empty;
+         }
+         return tbl->indices[Number];
+      }
+
+      const multi_index *_multidx;
+   };
+
+ private:
+   template <uint64_t IndexName, size_t I>
+   static constexpr size_t index_number()
+   {
+      static_assert(I < sizeof...(Indices), "name provided is not the name of any secondary index within multi_index");
+      return I;
+   }
+
+   template <uint64_t IndexName, size_t I, typename First, typename... Rest>
+   static constexpr size_t index_number()
+   {
+      if constexpr (static_cast<uint64_t>(First::index_name) == IndexName)
+         return I;
+      else
+         return index_number<IndexName, I + 1, Rest...>();
+   }
+
+   native::table_id id() const { return {_code.value, _scope, static_cast<uint64_t>(TableName)}; }
+
+   const native::table *table() const { return native::db().find_table(id()); }
+
+   static std::vector<std::string> secondary_keys(const T &obj)
+   {
+      return {native::to_secondary_key(typename Indices::secondary_extractor_type()(obj))...};
+   }
+
+   const T &load(uint64_t pk) const
+   {
+      auto cached = _objects.find(pk);
+      if (cached != _objects.end())
+      {
+         return *cached->second;
+      }
+
+      const auto *r = native::db().find(id(), pk);
+      check(r != nullptr, "unable to load object, row no longer exists");
+
+      auto obj = std::make_unique<T>();
+      datastream<const char *> ds(r->value.data(), r->value.size());
+      ds >> *obj;
+      auto &ref = *obj;
+      _objects[pk] = std::move(obj);
+      return ref;
+   }
+
+   name _code;
+   uint64_t _scope;
+   mutable std::map<uint64_t, std::unique_ptr<T>> _objects;
+};
+
+} // namespace eosio
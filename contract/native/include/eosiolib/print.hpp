@@ -0,0 +1,48 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's print(). Output is appended to the
+ *  console of the action currently executing in the native harness.
+ */
+#pragma once
+
+#include <eosiolib/asset.hpp>
+#include <eosiolib/name.hpp>
+#include <eosiolib/symbol.hpp>
+
+#include <string>
+#include <type_traits>
+
+namespace eosio
+{
+namespace native
+{
+void console_append(const std::string &text);
+} // namespace native
+
+inline void print(const char *s) { native::console_append(s); }
+inline void print(const std::string &s) { native::console_append(s); }
+inline void print(char c) { native::console_append(std::string(1, c)); }
+inline void print(bool b) { native::console_append(b ? "true" : "false"); }
+inline void print(name n) { native::console_append(n.to_string()); }
+inline void print(symbol_code s) { native::console_append(s.to_string()); }
+inline void print(const asset &a) { native::console_append(a.to_string()); }
+
+template <typename T, std::enable_if_t<std::is_arithmetic<T>::value> * = nullptr>
+inline void print(T v)
+{
+   native::console_append(std::to_string(v));
+}
+
+// Two or more arguments only; a single non-const argument would otherwise
+// bind here in preference to the const & overloads above.
+template <typename Arg, typename Arg2, typename... Args>
+void print(Arg &&a, Arg2 &&b, Args &&... args)
+{
+   print(std::forward<Arg>(a));
+   print(std::forward<Arg2>(b));
+   (print(std::forward<Args>(args)), ...);
+}
+
+} // namespace eosio
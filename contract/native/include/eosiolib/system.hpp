@@ -0,0 +1,56 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's assertion and time intrinsics. A failed
+ *  check() throws eosio::native::assert_exception, which the harness treats
+ *  like an aborted transaction.
+ */
+#pragma once
+
+#include <eosiolib/name.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace eosio
+{
+namespace native
+{
+
+struct assert_exception : std::runtime_error
+{
+   using std::runtime_error::runtime_error;
+};
+
+} // namespace native
+
+inline void check(bool pred, const char *msg)
+{
+   if (!pred)
+   {
+      throw native::assert_exception(msg);
+   }
+}
+
+inline void check(bool pred, const std::string &msg)
+{
+   if (!pred)
+   {
+      throw native::assert_exception(msg);
+   }
+}
+
+inline void check(bool pred, const char *msg, size_t n)
+{
+   if (!pred)
+   {
+      throw native::assert_exception(std::string(msg, n));
+   }
+}
+
+} // namespace eosio
+
+/// Seconds since epoch of the block the current action executes in.
+uint32_t now();
@@ -0,0 +1,10 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host-side stand-in for eosio.cdt's transaction header. Deferred
+ *  transactions are not modelled by the native harness.
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
@@ -0,0 +1,79 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Binary capture of actions to replay against the native chain. A log is an
+ *  8-byte magic and a version, then per action a little-endian uint32 length
+ *  followed by the packed logged_action.
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace eosio
+{
+namespace native
+{
+
+struct logged_action
+{
+   /// Seconds since epoch of the block the action was included in.
+   uint32_t block_time = 0;
+   action act;
+};
+
+class action_log_writer
+{
+ public:
+   /// Creates, or truncates, the log. Throws std::runtime_error on I/O errors.
+   explicit action_log_writer(const std::string &path);
+   ~action_log_writer();
+
+   action_log_writer(const action_log_writer &) = delete;
+   action_log_writer &operator=(const action_log_writer &) = delete;
+
+   void append(const logged_action &entry);
+   void flush();
+
+   uint64_t count() const { return _count; }
+
+ private:
+   FILE *_file = nullptr;
+   std::vector<char> _buffer;
+   uint64_t _count = 0;
+};
+
+class action_log_reader
+{
+ public:
+   explicit action_log_reader(const std::string &path);
+   ~action_log_reader();
+
+   action_log_reader(const action_log_reader &) = delete;
+   action_log_reader &operator=(const action_log_reader &) = delete;
+
+   /// Reads the next action; false at the end of the log.
+   bool next(logged_action &entry);
+
+   /// Skips `count` actions, e.g. those a checkpoint already covers; false if the log is shorter.
+   bool skip(uint64_t count);
+
+   /// Actions read or skipped so far.
+   uint64_t position() const { return _position; }
+
+ private:
+   bool read_record();
+
+   FILE *_file = nullptr;
+   std::string _path;
+   std::vector<char> _buffer;
+   uint64_t _position = 0;
+};
+
+} // namespace native
+} // namespace eosio
@@ -0,0 +1,171 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Minimal single-node chain used to run contracts natively. It provides the
+ *  intrinsics behind the eosiolib stand-ins (authorization, notifications,
+ *  inline actions, action data, block time, RAM billing) and executes actions
+ *  with nodeos' ordering: the action itself, then its notifications, then its
+ *  inline actions depth-first. A transaction either applies completely or is
+ *  rolled back.
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
+#include <eosiolib/name.hpp>
+#include <native/database.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace eosio
+{
+namespace native
+{
+
+using apply_handler = void (*)(uint64_t receiver, uint64_t code, uint64_t action);
+
+struct action_trace
+{
+   name receiver;
+   name account;
+   name action;
+   uint32_t depth = 0;
+   std::string console;
+};
+
+#ifdef TOKEN_NATIVE_INSTRUMENT
+struct table_ops
+{
+   uint64_t emplaced = 0;
+   uint64_t modified = 0;
+   uint64_t erased = 0;
+};
+
+/// What one executed action (one receiver) did to RAM, built with TOKEN_NATIVE_INSTRUMENT.
+struct action_profile
+{
+   name receiver;
+   name account;
+   name action;
+   uint32_t depth = 0;
+
+   /// Row writes keyed by table name, summed over scopes.
+   std::map<name, table_ops> tables;
+
+   /// Net bytes billed to each payer; negative when RAM was released.
+   std::map<name, int64_t> ram_deltas;
+
+   uint32_t inline_actions = 0;
+};
+#endif
+
+class chain
+{
+ public:
+   /// The most recently constructed chain becomes the one intrinsics talk to.
+   chain();
+   ~chain();
+
+   chain(const chain &) = delete;
+   chain &operator=(const chain &) = delete;
+
+   static chain &active();
+
+   void create_account(name account);
+   bool is_account(name account) const { return _implicit_accounts || _accounts.count(account) > 0; }
+
+   /// Treats every name as an existing account, as when replaying actions that already succeeded on chain.
+   void set_implicit_accounts(bool implicit) { _implicit_accounts = implicit; }
+   void set_code(name account, apply_handler handler);
+
+   void set_time(uint32_t seconds) { _time = seconds; }
+   void advance_time(uint32_t seconds) { _time += seconds; }
+   uint32_t time() const { return _time; }
+
+   database &db() { return _db; }
+   const database &db() const { return _db; }
+
+   /// Executes the actions as one transaction; on failure the state is rolled back and the error rethrown.
+   void push_transaction(const std::vector<action> &actions);
+
+   void push_action(const action &act) { push_transaction({act}); }
+
+   template <typename... Args>
+   void push(name account, name act, std::vector<permission_level> auths, const Args &... args)
+   {
+      push_action(action(std::move(auths), account, act, std::make_tuple(args...)));
+   }
+
+   /// Action traces of the last transaction; only recorded when enabled.
+   void enable_traces(bool enabled) { _traces_enabled = enabled; }
+   const std::vector<action_trace> &traces() const { return _traces; }
+
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   /// Receives the profile of every action of each committed transaction, in execution order.
+   using profile_hook = std::function<void(const action_profile &)>;
+
+   void set_profile_hook(profile_hook hook) { _profile_hook = std::move(hook); }
+#endif
+
+   int64_t ram_usage(name account) const;
+   const std::map<uint64_t, int64_t> &ram_usage() const { return _ram_usage; }
+
+   /// Replaces the RAM billed so far; used when loading checkpoints.
+   void restore_ram_usage(std::map<uint64_t, int64_t> usage) { _ram_usage = std::move(usage); }
+
+   /// Number of inline actions sent since construction.
+   uint64_t inline_actions_sent() const { return _inline_actions_sent; }
+
+   // Intrinsic support for the eosiolib stand-ins.
+   const std::vector<char> &action_data() const;
+   uint64_t receiver() const;
+   bool has_auth(name account) const;
+   void require_auth(const permission_level &level) const;
+   void require_recipient(name account);
+   void send_inline(const action &act);
+   void console_append(const std::string &text);
+
+ private:
+   struct context
+   {
+      const action *act = nullptr;
+      name receiver;
+      std::vector<name> notified;
+      std::vector<action> inlines;
+      std::string console;
+#ifdef TOKEN_NATIVE_INSTRUMENT
+      action_profile profile;
+#endif
+   };
+
+   void execute(const action &act, uint32_t depth);
+   void apply(context &ctx, uint32_t depth);
+   void bill(uint64_t payer, int64_t delta);
+   context &current() const;
+
+   database _db;
+   std::set<name> _accounts;
+   bool _implicit_accounts = false;
+   std::map<name, apply_handler> _code;
+   std::map<uint64_t, int64_t> _ram_usage;
+   /// RAM deltas billed by the current transaction, undone if it fails.
+   std::vector<std::pair<uint64_t, int64_t>> _ram_undo;
+   uint32_t _time = 0;
+   context *_ctx = nullptr;
+   bool _traces_enabled = false;
+   std::vector<action_trace> _traces;
+   uint64_t _inline_actions_sent = 0;
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   profile_hook _profile_hook;
+   std::vector<action_profile> _profiles;
+#endif
+   chain *_previous = nullptr;
+};
+
+} // namespace native
+} // namespace eosio
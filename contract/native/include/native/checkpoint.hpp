@@ -0,0 +1,87 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Snapshots of the native chain's state: every row of every table with its
+ *  payer and secondary keys, the RAM billed per payer, the block time and
+ *  the number of log actions the state reflects. Rows are stored serialized
+ *  exactly as the contract wrote them, so a checkpoint is also a dump of the
+ *  contract's tables that can be read back with the structs of token.hpp.
+ */
+#pragma once
+
+#include <native/chain.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace eosio
+{
+namespace native
+{
+
+struct checkpoint_info
+{
+   /// Actions of the log applied before the checkpoint was taken.
+   uint64_t position = 0;
+   uint32_t time = 0;
+   std::map<uint64_t, int64_t> ram_usage;
+};
+
+/// One table of a checkpoint, its rows in primary key order.
+struct checkpoint_table
+{
+   uint64_t code;
+   uint64_t scope;
+   uint64_t table;
+   std::vector<std::pair<uint64_t, row>> rows;
+};
+
+/// Reads a checkpoint one table at a time, in (code, scope, table) order, so
+/// dumps larger than memory can be scanned.
+class checkpoint_reader
+{
+ public:
+   /// Reads the header; throws std::runtime_error if the file isn't a checkpoint.
+   explicit checkpoint_reader(const std::string &path);
+   ~checkpoint_reader();
+
+   checkpoint_reader(const checkpoint_reader &) = delete;
+   checkpoint_reader &operator=(const checkpoint_reader &) = delete;
+
+   const checkpoint_info &info() const { return _info; }
+   uint64_t table_count() const { return _table_count; }
+
+   /// Reads the id of the next table, to be followed by read() or skip(); false after the last.
+   bool next_id(table_id &id);
+
+   /// The table whose id was just read, packed as a checkpoint_table, e.g. to unpack on another thread.
+   void read(std::vector<char> &record);
+   void skip();
+
+   bool next(checkpoint_table &tbl);
+
+ private:
+   FILE *_file = nullptr;
+   std::string _path;
+   checkpoint_info _info;
+   uint64_t _table_count = 0;
+   uint64_t _read = 0;
+   table_id _id;
+   uint64_t _size = 0;
+};
+
+/// Throws std::runtime_error on I/O errors.
+void save_checkpoint(const std::string &path, const chain &c, uint64_t position);
+
+/// Replaces the rows of `db` with those of the checkpoint.
+checkpoint_info load_checkpoint(const std::string &path, database &db);
+
+/// Restores rows, RAM usage and time into `c` and returns the log position to resume from.
+uint64_t load_checkpoint(const std::string &path, chain &c);
+
+} // namespace native
+} // namespace eosio
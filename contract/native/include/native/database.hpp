@@ -0,0 +1,340 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  In-memory table store backing the host-side eosio::multi_index. Rows are
+ *  kept serialized, exactly as nodeos stores them, so row sizes and RAM
+ *  billing match the chain. Every write is recorded in an undo log while a
+ *  session is open so a failed transaction can be rolled back.
+ */
+#pragma once
+
+#include <eosiolib/fixed_bytes.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace eosio
+{
+namespace native
+{
+
+struct table_id
+{
+   uint64_t code = 0;
+   uint64_t scope = 0;
+   uint64_t table = 0;
+
+   friend bool operator<(const table_id &a, const table_id &b)
+   {
+      return std::tie(a.code, a.scope, a.table) < std::tie(b.code, b.scope, b.table);
+   }
+   friend bool operator==(const table_id &a, const table_id &b)
+   {
+      return std::tie(a.code, a.scope, a.table) == std::tie(b.code, b.scope, b.table);
+   }
+};
+
+struct row
+{
+   uint64_t payer = 0;
+   std::vector<char> value;
+
+   /// One order-preserving key per secondary index of the table.
+   std::vector<std::string> secondary;
+};
+
+using secondary_entry = std::pair<std::string, uint64_t>;
+
+struct table
+{
+   std::map<uint64_t, row> rows;
+   std::vector<std::set<secondary_entry>> indices;
+};
+
+/// Approximations of nodeos' billable_size for the objects a row creates.
+static constexpr int64_t billable_row_overhead = 108;
+static constexpr int64_t billable_secondary_overhead = 128;
+static constexpr int64_t billable_table_overhead = 108;
+
+inline int64_t billable_size(const row &r)
+{
+   return billable_row_overhead + int64_t(r.value.size()) +
+          billable_secondary_overhead * int64_t(r.secondary.size());
+}
+
+enum class db_op
+{
+   emplace,
+   modify,
+   erase
+};
+
+/// Aggregate table-access counters, always maintained.
+struct db_counters
+{
+   uint64_t finds = 0;
+   uint64_t emplaces = 0;
+   uint64_t modifies = 0;
+   uint64_t erases = 0;
+};
+
+class database
+{
+ public:
+   /// Called for every RAM delta; the chain uses it to bill and authorize payers.
+   using billing_hook = std::function<void(uint64_t payer, int64_t delta)>;
+
+   void set_billing_hook(billing_hook hook) { _billing = std::move(hook); }
+
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   /// Called for every row write, before it is billed.
+   using op_hook = std::function<void(const table_id &id, db_op op)>;
+
+   void set_op_hook(op_hook hook) { _op = std::move(hook); }
+#endif
+
+   const table *find_table(const table_id &id) const
+   {
+      auto itr = _tables.find(id);
+      return itr == _tables.end() ? nullptr : &itr->second;
+   }
+
+   const row *find(const table_id &id, uint64_t pk) const
+   {
+      ++_counters.finds;
+      auto tbl = find_table(id);
+      if (!tbl)
+      {
+         return nullptr;
+      }
+      auto itr = tbl->rows.find(pk);
+      return itr == tbl->rows.end() ? nullptr : &itr->second;
+   }
+
+   void emplace(const table_id &id, uint64_t pk, row r)
+   {
+      ++_counters.emplaces;
+      notify(id, db_op::emplace);
+      auto itr = _tables.find(id);
+      if (itr == _tables.end() || itr->second.rows.empty())
+      {
+         bill(r.payer, billable_table_overhead);
+      }
+      auto &tbl = _tables[id];
+      bill(r.payer, billable_size(r));
+      record(id, pk, std::nullopt);
+      insert_row(tbl, pk, std::move(r));
+   }
+
+   void modify(const table_id &id, uint64_t pk, uint64_t payer, std::vector<char> value,
+               std::vector<std::string> secondary)
+   {
+      ++_counters.modifies;
+      notify(id, db_op::modify);
+      auto &tbl = _tables.at(id);
+      auto &old = tbl.rows.at(pk);
+      record(id, pk, old);
+
+      row updated{payer, std::move(value), std::move(secondary)};
+      if (payer == old.payer)
+      {
+         bill(payer, billable_size(updated) - billable_size(old));
+      }
+      else
+      {
+         bill(old.payer, -billable_size(old));
+         bill(payer, billable_size(updated));
+      }
+
+      remove_row(tbl, pk);
+      insert_row(tbl, pk, std::move(updated));
+   }
+
+   void erase(const table_id &id, uint64_t pk)
+   {
+      ++_counters.erases;
+      notify(id, db_op::erase);
+      auto &tbl = _tables.at(id);
+      auto &old = tbl.rows.at(pk);
+      record(id, pk, old);
+
+      const auto payer = old.payer;
+      bill(payer, -billable_size(old));
+      remove_row(tbl, pk);
+      if (tbl.rows.empty())
+      {
+         bill(payer, -billable_table_overhead);
+      }
+   }
+
+   /// Opens an undo session; writes are recorded until commit() or rollback().
+   void start_undo()
+   {
+      _undo_active = true;
+      _undo.clear();
+   }
+
+   void commit()
+   {
+      _undo_active = false;
+      _undo.clear();
+   }
+
+   void rollback()
+   {
+      _undo_active = false;
+      for (auto itr = _undo.rbegin(); itr != _undo.rend(); ++itr)
+      {
+         auto &tbl = _tables[itr->id];
+         if (tbl.rows.count(itr->pk))
+         {
+            remove_row(tbl, itr->pk);
+         }
+         if (itr->previous)
+         {
+            insert_row(tbl, itr->pk, std::move(*itr->previous));
+         }
+      }
+      _undo.clear();
+   }
+
+   const std::map<table_id, table> &tables() const { return _tables; }
+
+   /// Replaces a row without billing or undo; used when loading checkpoints.
+   void restore(const table_id &id, uint64_t pk, row r)
+   {
+      auto &tbl = _tables[id];
+      if (tbl.rows.count(pk))
+      {
+         remove_row(tbl, pk);
+      }
+      insert_row(tbl, pk, std::move(r));
+   }
+
+   void clear()
+   {
+      _tables.clear();
+      _undo.clear();
+      _undo_active = false;
+   }
+
+   const db_counters &counters() const { return _counters; }
+   void reset_counters() { _counters = db_counters(); }
+
+ private:
+   struct undo_entry
+   {
+      table_id id;
+      uint64_t pk;
+      std::optional<row> previous;
+   };
+
+   void bill(uint64_t payer, int64_t delta)
+   {
+      if (_billing && delta != 0)
+      {
+         _billing(payer, delta);
+      }
+   }
+
+   void notify(const table_id &id, db_op op)
+   {
+#ifdef TOKEN_NATIVE_INSTRUMENT
+      if (_op)
+      {
+         _op(id, op);
+      }
+#else
+      (void)id;
+      (void)op;
+#endif
+   }
+
+   void record(const table_id &id, uint64_t pk, std::optional<row> previous)
+   {
+      if (_undo_active)
+      {
+         _undo.push_back({id, pk, std::move(previous)});
+      }
+   }
+
+   static void insert_row(table &tbl, uint64_t pk, row r)
+   {
+      if (tbl.indices.size() < r.secondary.size())
+      {
+         tbl.indices.resize(r.secondary.size());
+      }
+      for (size_t i = 0; i < r.secondary.size(); ++i)
+      {
+         tbl.indices[i].emplace(r.secondary[i], pk);
+      }
+      tbl.rows[pk] = std::move(r);
+   }
+
+   static void remove_row(table &tbl, uint64_t pk)
+   {
+      auto itr = tbl.rows.find(pk);
+      for (size_t i = 0; i < itr->second.secondary.size(); ++i)
+      {
+         tbl.indices[i].erase({itr->second.secondary[i], pk});
+      }
+      tbl.rows.erase(itr);
+   }
+
+   std::map<table_id, table> _tables;
+   std::vector<undo_entry> _undo;
+   bool _undo_active = false;
+   billing_hook _billing;
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   op_hook _op;
+#endif
+   mutable db_counters _counters;
+};
+
+/// Order-preserving byte encodings of secondary keys (big-endian).
+inline std::string to_secondary_key(uint64_t v)
+{
+   std::string key(8, '\0');
+   for (int i = 7; i >= 0; --i, v >>= 8)
+   {
+      key[i] = char(v & 0xFF);
+   }
+   return key;
+}
+
+inline std::string to_secondary_key(uint128_t v)
+{
+   return to_secondary_key(uint64_t(v >> 64)) + to_secondary_key(uint64_t(v));
+}
+
+inline std::string to_secondary_key(double v)
+{
+   uint64_t bits;
+   memcpy(&bits, &v, sizeof(bits));
+   bits = (bits & (1ull << 63)) ? ~bits : (bits | (1ull << 63));
+   return to_secondary_key(bits);
+}
+
+template <size_t Size>
+std::string to_secondary_key(const fixed_bytes<Size> &v)
+{
+   auto arr = v.extract_as_byte_array();
+   return std::string((const char *)arr.data(), arr.size());
+}
+
+database &db();
+
+/// Account whose code is currently executing; only it may write its tables.
+uint64_t current_receiver();
+
+} // namespace native
+} // namespace eosio
@@ -0,0 +1,40 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  secp256k1 signing for the native harness, producing EOSIO-format
+ *  (compressed, canonical) signatures that the assert_recover_key stand-in
+ *  accepts.
+ */
+#pragma once
+
+#include <eosiolib/crypto.hpp>
+#include <eosiolib/fixed_bytes.hpp>
+
+#include <array>
+#include <string>
+
+namespace eosio
+{
+namespace native
+{
+
+class private_key
+{
+ public:
+   /// Derives a deterministic key from sha256(seed).
+   static private_key from_seed(const std::string &seed);
+
+   explicit private_key(const std::array<uint8_t, 32> &secret);
+
+   const public_key &get_public_key() const { return _public; }
+
+   signature sign(const checksum256 &digest) const;
+
+ private:
+   std::array<uint8_t, 32> _secret;
+   public_key _public;
+};
+
+} // namespace native
+} // namespace eosio
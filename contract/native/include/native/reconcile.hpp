@@ -0,0 +1,159 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Checks the token's ledger invariants over a checkpoint of its tables:
+ *
+ *    - per symbol, the balances of all holders add up to the supply in stat;
+ *    - the contract's own PEOS balance covers what it holds for others:
+ *      stakes, pending refunds, UTXOs and dividends not yet realized;
+ *    - the stakes add up to the dividend row plus its shards, and what the
+ *      stakers could realize right now doesn't exceed what was distributed
+ *      to them and not realized yet;
+ *    - every row decodes with its token.hpp struct, sits under the key the
+ *      contract gives it and holds a valid amount of the right symbol.
+ *
+ *  Stakes and the dividend row not yet moved out of the legacy staked and
+ *  dividends tables are converted the way the contract converts them.
+ *
+ *  Staked, unstaked and distributed tokens are moved into the contract's
+ *  balance, so they are part of the supply once, through that balance.
+ *
+ *  The checkpoint is streamed: tables are grouped by scope, so all tables of
+ *  an owner are checked together, and the groups are decoded and summed on
+ *  worker threads. Memory is bounded by the read-ahead and the largest single
+ *  table, e.g. the refund queue, not by the number of holders.
+ */
+#pragma once
+
+#include <native/checkpoint.hpp>
+
+#include <token.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace eosio
+{
+namespace native
+{
+
+struct reconcile_options
+{
+   name contract = name("thepeostoken");
+
+   /// Worker threads, 0 for every core.
+   unsigned threads = 0;
+
+   /// Discrepancies kept in the report; all of them are counted.
+   size_t max_reports = 1000;
+
+   /// Bytes of tables read ahead of the workers.
+   size_t read_ahead = 64 << 20;
+};
+
+struct discrepancy
+{
+   /// The holder concerned, or the contract for ledger-wide totals.
+   name owner;
+   name table;
+   std::string message;
+};
+
+struct supply_totals
+{
+   symbol sym;
+   bool has_stat = false;
+   int64_t supply = 0;
+   int128_t balances = 0;
+   uint64_t holders = 0;
+};
+
+/// PEOS the contract holds on behalf of others.
+struct custody_totals
+{
+   int128_t contract_balance = 0;
+   int128_t staked = 0;
+   int128_t refunding = 0;
+   int128_t utxos = 0;
+   /// Distributed and not realized yet, including what nobody was staking for.
+   int128_t unclaimed_dividends = 0;
+   /// Distributed while stakes existed and not realized yet.
+   int128_t owed_dividends = 0;
+   /// What the stakers would realize right now; short of owed by rounding.
+   int128_t pending_dividends = 0;
+
+   uint64_t stakers = 0;
+   uint64_t refund_tranches = 0;
+   uint64_t utxo_count = 0;
+
+   int128_t liabilities() const { return staked + refunding + utxos + unclaimed_dividends; }
+};
+
+struct reconcile_report
+{
+   uint64_t position = 0;
+   uint64_t tables = 0;
+   uint64_t rows = 0;
+
+   std::vector<supply_totals> supplies;
+   custody_totals custody;
+
+   std::vector<discrepancy> discrepancies;
+   uint64_t discrepancy_count = 0;
+
+   double seconds = 0;
+
+   bool ok() const { return discrepancy_count == 0; }
+};
+
+/// Formats an amount of `sym` that may exceed an asset, e.g. a sum of balances.
+std::string format_amount(int128_t amount, symbol sym);
+
+class reconciler
+{
+ public:
+   explicit reconciler(reconcile_options options = {});
+
+   /// Throws std::runtime_error if the checkpoint can't be read.
+   reconcile_report check(const std::string &checkpoint);
+
+   /// Checks the live tables of a native chain on the calling thread, e.g. between fuzzed actions.
+   reconcile_report check(const database &db);
+
+ private:
+   struct scope_state;
+   struct partial;
+   struct batch;
+
+   void reset();
+   void read_contract_table(const checkpoint_table &tbl);
+   void read_contract_rows(const std::string &checkpoint);
+   void check_batch(const batch &work, partial &sums);
+   void check_next(const checkpoint_table &tbl, scope_state &scope, partial &sums);
+   void check_table(const checkpoint_table &tbl, scope_state &scope, partial &sums);
+   void check_totals(partial &sums, reconcile_report &result);
+   reconcile_report finish(partial &sums, uint64_t position, std::chrono::steady_clock::time_point started);
+
+   void report(name owner, name table, std::string message);
+
+   reconcile_options _options;
+
+   /// The contract's dividend row and UTXO counter, read before the rest.
+   bool _has_dividend = false;
+   token::dividend _dividend;
+   bool _has_utxo_global = false;
+   uint64_t _next_utxo_id = 0;
+
+   std::mutex _reports_mutex;
+   std::vector<discrepancy> _reports;
+   std::atomic<uint64_t> _report_count{0};
+};
+
+} // namespace native
+} // namespace eosio
@@ -0,0 +1,83 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Rebuilds contract state by running an action log through the contract's
+ *  own handlers on the native chain. Every name is treated as an existing
+ *  account and the logged authorizations are trusted, since the actions
+ *  already passed those checks on chain; each action runs as a transaction
+ *  of its own at its block's time.
+ */
+#pragma once
+
+#include <native/action_log.hpp>
+#include <native/chain.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace eosio
+{
+namespace native
+{
+
+struct replay_options
+{
+   /// Write a checkpoint every this many actions into checkpoint_dir; 0 disables them.
+   uint64_t checkpoint_interval = 0;
+   std::string checkpoint_dir = ".";
+
+   /// Stop at the first action that fails instead of counting it and moving on.
+   bool stop_on_error = false;
+
+   /// Stop after this many actions; 0 replays the whole log.
+   uint64_t limit = 0;
+};
+
+struct replay_stats
+{
+   uint64_t applied = 0;
+   uint64_t failed = 0;
+   uint64_t checkpoints = 0;
+   double seconds = 0;
+
+   double actions_per_second() const { return seconds > 0 ? double(applied + failed) / seconds : 0; }
+};
+
+class replayer
+{
+ public:
+   /// With `legacy_budgets` the empty chain starts with the issuance budgets
+   /// the contract hard-coded before setvesting existed (see seed_legacy_budgets).
+   explicit replayer(name contract = name("thepeostoken"), bool legacy_budgets = true);
+
+   chain &get_chain() { return _chain; }
+
+   /// Continues from a checkpoint instead of an empty chain; returns the log position it covers.
+   uint64_t resume(const std::string &checkpoint);
+
+   /// Called for each failed action with its log position and the error.
+   using failure_hook = std::function<void(uint64_t position, const logged_action &, const std::exception &)>;
+
+   void set_failure_hook(failure_hook hook) { _on_failure = std::move(hook); }
+
+   /// Replays the log from the resumed position, or from its start.
+   replay_stats replay(action_log_reader &log, const replay_options &options);
+
+   /// Path of the checkpoint taken after `position` actions.
+   static std::string checkpoint_path(const std::string &dir, uint64_t position);
+
+ private:
+   /// Mainnet history predates setvesting: without these schedules every
+   /// historical issue fails validate_vesting. Captures that already contain
+   /// the setvesting actions should be replayed without them.
+   void seed_legacy_budgets(name contract);
+
+   chain _chain;
+   uint64_t _position = 0;
+   failure_hook _on_failure;
+};
+
+} // namespace native
+} // namespace eosio
@@ -0,0 +1,125 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Convenience wrapper that deploys the token contract on a native chain and
+ *  pushes its actions with typed arguments. Shared by the benchmarks and the
+ *  other host-side tools.
+ */
+#pragma once
+
+#include <native/chain.hpp>
+#include <native/keys.hpp>
+
+#include <token.hpp>
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+extern "C" void apply(uint64_t receiver, uint64_t code, uint64_t action);
+
+namespace eosio
+{
+namespace native
+{
+
+class token_tester
+{
+ public:
+   static constexpr name contract_account = "thepeostoken"_n;
+   static constexpr name marketing_account = "peosmarketin"_n;
+   static constexpr name teamfund_account = "peosteamfund"_n;
+
+   /// 2019-06-01, inside the team vesting window.
+   static constexpr uint32_t default_time = 1559347200;
+
+   /// Deploys the contract, creates PEOS with the contract as issuer and sets
+   /// the marketing, team fund and contract issuance budgets.
+   explicit token_tester(uint32_t time = default_time);
+
+   chain &get_chain() { return _chain; }
+
+   static asset peos(int64_t amount) { return asset(amount, PEOS_SYMBOL); }
+
+   /// Deterministic distinct account names for generated workloads.
+   static name account_name(uint64_t index);
+
+   void create_account(name account) { _chain.create_account(account); }
+   void create_accounts(std::initializer_list<name> accounts);
+
+   /// Issues to the marketing budget and moves `quantity` to `owner` as a claimed balance.
+   void fund(name owner, asset quantity);
+
+   void set_vesting(name account, asset total, uint32_t start = 0, uint32_t cliff = 0, uint32_t duration = 0,
+                    uint32_t step = 0);
+   void issue(name to, asset quantity, const std::string &memo = "");
+   void issuemany(const std::vector<token::recipient> &recipients, const std::string &memo = "");
+   void transfer(name from, name to, asset quantity, const std::string &memo = "");
+   void transfermany(name from, const std::vector<token::recipient> &recipients, const std::string &memo = "");
+   void claim(name owner);
+   void setdroproot(const checksum256 &root);
+   void claimdrop(name owner, asset quantity, const std::vector<checksum256> &proof);
+
+   /// Leaf of `owner`'s allocation in a setdroproot tree.
+   static checksum256 drop_leaf_hash(name owner, asset quantity);
+
+   /// Parent of two nodes of a setdroproot tree, in either order.
+   static checksum256 drop_node_hash(const checksum256 &a, const checksum256 &b);
+
+   void recover(name owner);
+   void recovermany(const std::vector<name> &owners);
+   void migrateaccts(const std::vector<name> &owners);
+   void migratestake(const std::vector<name> &owners);
+   void stake(name owner, asset quantity);
+   void unstake(name owner, asset quantity);
+   void realizediv(name owner);
+   void refund(name owner);
+   void procrefunds(uint32_t max, name cranker = marketing_account);
+   void distribute(name owner, asset quantity);
+   /// Runs pendingdiv and returns what it printed.
+   std::string pendingdiv(name owner);
+
+   /// Runs getaccounts and returns the JSON it printed.
+   std::string getaccounts(const std::vector<name> &owners);
+   void loadutxo(name from, const public_key &pk, asset quantity);
+   void transferutxo(name payer, const std::vector<token::input> &inputs,
+                     const std::vector<token::output> &outputs, const std::string &memo = "");
+   void transferkeys(name payer, const std::vector<token::keyinput> &inputs,
+                     const std::vector<token::output> &outputs, const std::string &memo = "");
+
+   /// Digest an input of transferutxo must sign.
+   static checksum256 utxo_digest(uint64_t id, const std::vector<token::output> &outputs);
+
+   void sweeputxo(name payer, const public_key &pk, uint32_t max, const signature &sig);
+
+   /// Digest a sweeputxo whose lowest swept id is `first_id` must sign.
+   static checksum256 utxo_sweep_digest(uint64_t first_id, uint32_t max);
+
+   /// Digest a key input of transferkeys spending `ids` must sign.
+   static checksum256 utxo_key_digest(const std::vector<uint64_t> &ids, const std::vector<token::output> &outputs);
+
+   /// Id the next emitted UTXO will get.
+   uint64_t next_utxo_id() const;
+
+   asset balance(name owner) const;
+   asset supply() const;
+
+ private:
+   static std::vector<permission_level> active(name account) { return {{account, "active"_n}}; }
+
+   /// Pushes an unauthorized read-only action and returns the contract's console output.
+   template <typename... Args>
+   std::string console_of(name act, const Args &... args)
+   {
+      _chain.enable_traces(true);
+      _chain.push(contract_account, act, {}, args...);
+      _chain.enable_traces(false);
+      return _chain.traces().front().console;
+   }
+
+   chain _chain;
+};
+
+} // namespace native
+} // namespace eosio
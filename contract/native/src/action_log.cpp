@@ -0,0 +1,141 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#include <native/action_log.hpp>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace eosio
+{
+namespace native
+{
+
+namespace
+{
+
+constexpr char log_magic[8] = {'P', 'E', 'O', 'S', 'A', 'L', 'O', 'G'};
+constexpr uint32_t log_version = 1;
+
+/// Sanity bound on one record; actions are far smaller.
+constexpr uint32_t max_record_size = 1 << 24;
+
+} // namespace
+
+action_log_writer::action_log_writer(const std::string &path) : _file(fopen(path.c_str(), "wb"))
+{
+   if (!_file)
+   {
+      throw std::runtime_error("cannot create " + path);
+   }
+   if (fwrite(log_magic, 1, sizeof(log_magic), _file) != sizeof(log_magic) ||
+       fwrite(&log_version, sizeof(log_version), 1, _file) != 1)
+   {
+      fclose(_file);
+      throw std::runtime_error("cannot write " + path);
+   }
+}
+
+action_log_writer::~action_log_writer()
+{
+   fclose(_file);
+}
+
+void action_log_writer::append(const logged_action &entry)
+{
+   _buffer = pack(entry);
+   const auto size = uint32_t(_buffer.size());
+   if (fwrite(&size, sizeof(size), 1, _file) != 1 || fwrite(_buffer.data(), 1, size, _file) != size)
+   {
+      throw std::runtime_error("cannot append to action log");
+   }
+   ++_count;
+}
+
+void action_log_writer::flush()
+{
+   if (fflush(_file) != 0)
+   {
+      throw std::runtime_error("cannot flush action log");
+   }
+}
+
+action_log_reader::action_log_reader(const std::string &path) : _file(fopen(path.c_str(), "rb")), _path(path)
+{
+   if (!_file)
+   {
+      throw std::runtime_error("cannot open " + path);
+   }
+
+   char magic[sizeof(log_magic)];
+   uint32_t version = 0;
+   if (fread(magic, 1, sizeof(magic), _file) != sizeof(magic) || memcmp(magic, log_magic, sizeof(magic)) != 0 ||
+       fread(&version, sizeof(version), 1, _file) != 1)
+   {
+      fclose(_file);
+      throw std::runtime_error(path + " is not an action log");
+   }
+   if (version != log_version)
+   {
+      fclose(_file);
+      throw std::runtime_error(path + " has unsupported version " + std::to_string(version));
+   }
+}
+
+action_log_reader::~action_log_reader()
+{
+   fclose(_file);
+}
+
+bool action_log_reader::read_record()
+{
+   uint32_t size = 0;
+   if (fread(&size, sizeof(size), 1, _file) != 1)
+   {
+      return false;
+   }
+   if (size > max_record_size)
+   {
+      throw std::runtime_error(_path + ": corrupt record after action " + std::to_string(_position));
+   }
+   _buffer.resize(size);
+   if (fread(_buffer.data(), 1, size, _file) != size)
+   {
+      throw std::runtime_error(_path + ": truncated record after action " + std::to_string(_position));
+   }
+   ++_position;
+   return true;
+}
+
+bool action_log_reader::next(logged_action &entry)
+{
+   if (!read_record())
+   {
+      return false;
+   }
+   entry = unpack<logged_action>(_buffer);
+   return true;
+}
+
+bool action_log_reader::skip(uint64_t count)
+{
+   for (; count > 0; --count)
+   {
+      uint32_t size = 0;
+      if (fread(&size, sizeof(size), 1, _file) != 1)
+      {
+         return false;
+      }
+      if (size > max_record_size || fseek(_file, long(size), SEEK_CUR) != 0)
+      {
+         throw std::runtime_error(_path + ": corrupt record after action " + std::to_string(_position));
+      }
+      ++_position;
+   }
+   return true;
+}
+
+} // namespace native
+} // namespace eosio
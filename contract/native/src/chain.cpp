@@ -0,0 +1,333 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#include <native/chain.hpp>
+
+#include <eosiolib/print.hpp>
+#include <eosiolib/system.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace eosio
+{
+namespace native
+{
+
+static constexpr uint32_t max_inline_action_depth = 4;
+
+static chain *active_chain = nullptr;
+
+chain::chain() : _previous(active_chain)
+{
+   active_chain = this;
+   _db.set_billing_hook([this](uint64_t payer, int64_t delta) { bill(payer, delta); });
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   _db.set_op_hook([this](const table_id &id, db_op op) {
+      auto &ops = current().profile.tables[name(id.table)];
+      switch (op)
+      {
+      case db_op::emplace:
+         ++ops.emplaced;
+         break;
+      case db_op::modify:
+         ++ops.modified;
+         break;
+      case db_op::erase:
+         ++ops.erased;
+         break;
+      }
+   });
+#endif
+}
+
+chain::~chain()
+{
+   active_chain = _previous;
+}
+
+chain &chain::active()
+{
+   if (!active_chain)
+   {
+      throw std::logic_error("no native chain is active");
+   }
+   return *active_chain;
+}
+
+void chain::create_account(name account)
+{
+   _accounts.insert(account);
+}
+
+void chain::set_code(name account, apply_handler handler)
+{
+   create_account(account);
+   _code[account] = handler;
+}
+
+int64_t chain::ram_usage(name account) const
+{
+   auto itr = _ram_usage.find(account.value);
+   return itr == _ram_usage.end() ? 0 : itr->second;
+}
+
+void chain::push_transaction(const std::vector<action> &actions)
+{
+   check(!_ctx, "cannot push a transaction from inside an action");
+
+   _traces.clear();
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   _profiles.clear();
+#endif
+   _ram_undo.clear();
+   _db.start_undo();
+   try
+   {
+      for (const auto &act : actions)
+      {
+         execute(act, 0);
+      }
+   }
+   catch (...)
+   {
+      _ctx = nullptr;
+      _db.rollback();
+      for (auto itr = _ram_undo.rbegin(); itr != _ram_undo.rend(); ++itr)
+      {
+         _ram_usage[itr->first] -= itr->second;
+      }
+      throw;
+   }
+   _db.commit();
+
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   if (_profile_hook)
+   {
+      for (const auto &profile : _profiles)
+      {
+         _profile_hook(profile);
+      }
+   }
+#endif
+}
+
+void chain::execute(const action &act, uint32_t depth)
+{
+   check(depth <= max_inline_action_depth, "max inline action depth per transaction reached");
+   check(is_account(act.account), "action's account does not exist");
+
+   context ctx;
+   ctx.act = &act;
+   ctx.receiver = act.account;
+   apply(ctx, depth);
+
+   // Notifications may add further recipients while they run.
+   for (size_t i = 0; i < ctx.notified.size(); ++i)
+   {
+      context notify;
+      notify.act = &act;
+      notify.receiver = ctx.notified[i];
+      apply(notify, depth);
+      for (auto &n : notify.notified)
+      {
+         if (std::find(ctx.notified.begin(), ctx.notified.end(), n) == ctx.notified.end())
+         {
+            ctx.notified.push_back(n);
+         }
+      }
+      for (auto &inl : notify.inlines)
+      {
+         ctx.inlines.push_back(std::move(inl));
+      }
+   }
+
+   for (const auto &inl : ctx.inlines)
+   {
+      execute(inl, depth + 1);
+   }
+}
+
+void chain::apply(context &ctx, uint32_t depth)
+{
+   auto handler = _code.find(ctx.receiver);
+
+   auto *outer = _ctx;
+   _ctx = &ctx;
+   if (handler != _code.end())
+   {
+      handler->second(ctx.receiver.value, ctx.act->account.value, ctx.act->name.value);
+   }
+   _ctx = outer;
+
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   ctx.profile.receiver = ctx.receiver;
+   ctx.profile.account = ctx.act->account;
+   ctx.profile.action = ctx.act->name;
+   ctx.profile.depth = depth;
+   _profiles.push_back(std::move(ctx.profile));
+#endif
+
+   if (_traces_enabled)
+   {
+      _traces.push_back({ctx.receiver, ctx.act->account, ctx.act->name, depth, std::move(ctx.console)});
+   }
+}
+
+chain::context &chain::current() const
+{
+   check(_ctx != nullptr, "intrinsic called outside of an action");
+   return *_ctx;
+}
+
+const std::vector<char> &chain::action_data() const
+{
+   return current().act->data;
+}
+
+uint64_t chain::receiver() const
+{
+   return current().receiver.value;
+}
+
+bool chain::has_auth(name account) const
+{
+   for (const auto &auth : current().act->authorization)
+   {
+      if (auth.actor == account)
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+void chain::require_auth(const permission_level &level) const
+{
+   for (const auto &auth : current().act->authorization)
+   {
+      if (auth.actor == level.actor && (!level.permission || auth.permission == level.permission))
+      {
+         return;
+      }
+   }
+   check(false, "missing authority of " + level.actor.to_string());
+}
+
+void chain::require_recipient(name account)
+{
+   auto &ctx = current();
+   if (account == ctx.receiver)
+   {
+      return;
+   }
+   if (std::find(ctx.notified.begin(), ctx.notified.end(), account) == ctx.notified.end())
+   {
+      ctx.notified.push_back(account);
+   }
+}
+
+void chain::send_inline(const action &act)
+{
+   auto &ctx = current();
+   check(is_account(act.account), "inline action's code account does not exist");
+   ctx.inlines.push_back(act);
+   ++_inline_actions_sent;
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   ++ctx.profile.inline_actions;
+#endif
+}
+
+void chain::console_append(const std::string &text)
+{
+   if (_traces_enabled)
+   {
+      current().console += text;
+   }
+}
+
+void chain::bill(uint64_t payer, int64_t delta)
+{
+   if (delta > 0 && payer != receiver())
+   {
+      check(current().receiver == current().act->account, "Cannot charge RAM to other accounts during notify.");
+      check(has_auth(name(payer)), "unauthorized RAM usage increase for " + name(payer).to_string());
+   }
+   _ram_usage[payer] += delta;
+   _ram_undo.emplace_back(payer, delta);
+#ifdef TOKEN_NATIVE_INSTRUMENT
+   current().profile.ram_deltas[name(payer)] += delta;
+#endif
+}
+
+database &db()
+{
+   return chain::active().db();
+}
+
+uint64_t current_receiver()
+{
+   return chain::active().receiver();
+}
+
+void send_inline(const action &act)
+{
+   chain::active().send_inline(act);
+}
+
+void require_recipient(name notify_account)
+{
+   chain::active().require_recipient(notify_account);
+}
+
+void console_append(const std::string &text)
+{
+   chain::active().console_append(text);
+}
+
+} // namespace native
+
+uint32_t read_action_data(void *msg, uint32_t len)
+{
+   const auto &data = native::chain::active().action_data();
+   auto copy = std::min<size_t>(len, data.size());
+   if (copy)
+   {
+      memcpy(msg, data.data(), copy);
+   }
+   return copy;
+}
+
+uint32_t action_data_size()
+{
+   return native::chain::active().action_data().size();
+}
+
+void require_auth(name n)
+{
+   native::chain::active().require_auth(permission_level(n, name()));
+}
+
+void require_auth(const permission_level &level)
+{
+   native::chain::active().require_auth(level);
+}
+
+bool has_auth(name n)
+{
+   return native::chain::active().has_auth(n);
+}
+
+bool is_account(name n)
+{
+   return native::chain::active().is_account(n);
+}
+
+} // namespace eosio
+
+uint32_t now()
+{
+   return eosio::native::chain::active().time();
+}
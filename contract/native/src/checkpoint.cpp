@@ -0,0 +1,224 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#include <native/checkpoint.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace eosio
+{
+namespace native
+{
+
+namespace
+{
+
+constexpr char checkpoint_magic[8] = {'P', 'E', 'O', 'S', 'C', 'K', 'P', 'T'};
+constexpr uint32_t checkpoint_version = 1;
+
+using file_ptr = std::unique_ptr<FILE, int (*)(FILE *)>;
+
+struct checkpoint_head
+{
+   uint64_t position;
+   uint32_t time;
+   std::vector<std::pair<uint64_t, int64_t>> ram_usage;
+   uint64_t table_count;
+};
+
+void write_record(FILE *file, const std::vector<char> &bytes, const std::string &path)
+{
+   const uint64_t size = bytes.size();
+   if (fwrite(&size, sizeof(size), 1, file) != 1 || fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size())
+   {
+      throw std::runtime_error("cannot write " + path);
+   }
+}
+
+std::vector<char> read_record(FILE *file, const std::string &path)
+{
+   uint64_t size = 0;
+   if (fread(&size, sizeof(size), 1, file) != 1)
+   {
+      throw std::runtime_error(path + " is truncated");
+   }
+   std::vector<char> bytes(size);
+   if (fread(bytes.data(), 1, size, file) != size)
+   {
+      throw std::runtime_error(path + " is truncated");
+   }
+   return bytes;
+}
+
+} // namespace
+
+checkpoint_reader::checkpoint_reader(const std::string &path) : _path(path)
+{
+   _file = fopen(path.c_str(), "rb");
+   if (!_file)
+   {
+      throw std::runtime_error("cannot open " + path);
+   }
+   // tables are read front to back, so a large buffer saves most syscalls
+   setvbuf(_file, nullptr, _IOFBF, 1 << 20);
+
+   char magic[sizeof(checkpoint_magic)];
+   uint32_t version = 0;
+   if (fread(magic, 1, sizeof(magic), _file) != sizeof(magic) ||
+       memcmp(magic, checkpoint_magic, sizeof(magic)) != 0 || fread(&version, sizeof(version), 1, _file) != 1)
+   {
+      fclose(_file);
+      throw std::runtime_error(path + " is not a checkpoint");
+   }
+   if (version != checkpoint_version)
+   {
+      fclose(_file);
+      throw std::runtime_error(path + " has unsupported version " + std::to_string(version));
+   }
+
+   try
+   {
+      const auto head = unpack<checkpoint_head>(read_record(_file, path));
+      _info = {head.position, head.time, {head.ram_usage.begin(), head.ram_usage.end()}};
+      _table_count = head.table_count;
+   }
+   catch (...)
+   {
+      fclose(_file);
+      throw;
+   }
+}
+
+checkpoint_reader::~checkpoint_reader()
+{
+   fclose(_file);
+}
+
+bool checkpoint_reader::next_id(table_id &id)
+{
+   if (_read == _table_count)
+   {
+      return false;
+   }
+   // the record's length, then the packed code, scope and table
+   uint64_t head[4];
+   if (fread(head, sizeof(head), 1, _file) != 1 || head[0] < sizeof(head) - sizeof(head[0]))
+   {
+      throw std::runtime_error(_path + " is truncated");
+   }
+   _size = head[0];
+   _id = id = {head[1], head[2], head[3]};
+   ++_read;
+   return true;
+}
+
+void checkpoint_reader::read(std::vector<char> &record)
+{
+   const uint64_t ids[3] = {_id.code, _id.scope, _id.table};
+   record.resize(_size);
+   memcpy(record.data(), ids, sizeof(ids));
+   if (fread(record.data() + sizeof(ids), 1, _size - sizeof(ids), _file) != _size - sizeof(ids))
+   {
+      throw std::runtime_error(_path + " is truncated");
+   }
+}
+
+void checkpoint_reader::skip()
+{
+   if (fseeko(_file, off_t(_size - 3 * sizeof(uint64_t)), SEEK_CUR) != 0)
+   {
+      throw std::runtime_error(_path + " is truncated");
+   }
+}
+
+bool checkpoint_reader::next(checkpoint_table &tbl)
+{
+   table_id id;
+   if (!next_id(id))
+   {
+      return false;
+   }
+   std::vector<char> record;
+   read(record);
+   tbl = unpack<checkpoint_table>(record);
+   return true;
+}
+
+void save_checkpoint(const std::string &path, const chain &c, uint64_t position)
+{
+   // written next to the target and renamed, so a crash never leaves a partial checkpoint
+   const auto temp = path + ".tmp";
+   {
+      file_ptr file(fopen(temp.c_str(), "wb"), fclose);
+      if (!file)
+      {
+         throw std::runtime_error("cannot create " + temp);
+      }
+
+      // a table whose rows were all erased no longer exists on chain, nor after a restore
+      const auto &tables = c.db().tables();
+      uint64_t table_count = 0;
+      for (const auto &entry : tables)
+      {
+         table_count += !entry.second.rows.empty();
+      }
+      checkpoint_head head{position, c.time(), {c.ram_usage().begin(), c.ram_usage().end()}, table_count};
+      if (fwrite(checkpoint_magic, 1, sizeof(checkpoint_magic), file.get()) != sizeof(checkpoint_magic) ||
+          fwrite(&checkpoint_version, sizeof(checkpoint_version), 1, file.get()) != 1)
+      {
+         throw std::runtime_error("cannot write " + temp);
+      }
+      write_record(file.get(), pack(head), temp);
+
+      for (const auto &[id, tbl] : tables)
+      {
+         if (tbl.rows.empty())
+         {
+            continue;
+         }
+         checkpoint_table record{id.code, id.scope, id.table, {tbl.rows.begin(), tbl.rows.end()}};
+         write_record(file.get(), pack(record), temp);
+      }
+
+      if (fflush(file.get()) != 0)
+      {
+         throw std::runtime_error("cannot write " + temp);
+      }
+   }
+   if (rename(temp.c_str(), path.c_str()) != 0)
+   {
+      throw std::runtime_error("cannot rename " + temp + " to " + path);
+   }
+}
+
+checkpoint_info load_checkpoint(const std::string &path, database &db)
+{
+   checkpoint_reader reader(path);
+
+   db.clear();
+   checkpoint_table tbl;
+   while (reader.next(tbl))
+   {
+      for (auto &[pk, r] : tbl.rows)
+      {
+         db.restore({tbl.code, tbl.scope, tbl.table}, pk, std::move(r));
+      }
+   }
+   return reader.info();
+}
+
+uint64_t load_checkpoint(const std::string &path, chain &c)
+{
+   auto info = load_checkpoint(path, c.db());
+   c.set_time(info.time);
+   c.restore_ram_usage(std::move(info.ram_usage));
+   return info.position;
+}
+
+} // namespace native
+} // namespace eosio
@@ -0,0 +1,248 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include <eosiolib/crypto.hpp>
+#include <eosiolib/system.hpp>
+#include <native/keys.hpp>
+
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/obj_mac.h>
+#include <openssl/sha.h>
+
+#include <cstring>
+#include <memory>
+#include <optional>
+
+namespace eosio
+{
+namespace
+{
+
+/// EOSIO prefixes compact signatures with recovery id + 27 + 4 (compressed key).
+constexpr uint8_t compact_header_base = 27 + 4;
+
+struct curve
+{
+   EC_GROUP *group;
+   BIGNUM *order;
+   BIGNUM *half_order;
+   BIGNUM *field;
+
+   curve()
+   {
+      group = EC_GROUP_new_by_curve_name(NID_secp256k1);
+      order = BN_new();
+      half_order = BN_new();
+      field = BN_new();
+      EC_GROUP_get_order(group, order, nullptr);
+      BN_rshift1(half_order, order);
+      EC_GROUP_get_curve(group, field, nullptr, nullptr, nullptr);
+   }
+};
+
+const curve &secp256k1()
+{
+   static const curve c;
+   return c;
+}
+
+struct bn_ctx_deleter
+{
+   void operator()(BN_CTX *c) const { BN_CTX_free(c); }
+};
+struct point_deleter
+{
+   void operator()(EC_POINT *p) const { EC_POINT_free(p); }
+};
+
+using bn_ctx_ptr = std::unique_ptr<BN_CTX, bn_ctx_deleter>;
+using point_ptr = std::unique_ptr<EC_POINT, point_deleter>;
+
+std::optional<std::array<char, 33>> serialize_point(const EC_POINT *point, BN_CTX *ctx)
+{
+   std::array<char, 33> out;
+   if (EC_POINT_point2oct(secp256k1().group, point, POINT_CONVERSION_COMPRESSED, (unsigned char *)out.data(), out.size(), ctx) != out.size())
+   {
+      return std::nullopt;
+   }
+   return out;
+}
+
+/// Public key recovery from an (r, s, recid) signature, SEC 1 section 4.1.6.
+std::optional<std::array<char, 33>> recover(const std::array<uint8_t, 32> &digest, const uint8_t *rs, int recid)
+{
+   const auto &c = secp256k1();
+   bn_ctx_ptr ctx(BN_CTX_new());
+   BN_CTX_start(ctx.get());
+
+   BIGNUM *r = BN_CTX_get(ctx.get());
+   BIGNUM *s = BN_CTX_get(ctx.get());
+   BIGNUM *x = BN_CTX_get(ctx.get());
+   BIGNUM *e = BN_CTX_get(ctx.get());
+   BIGNUM *rinv = BN_CTX_get(ctx.get());
+   BIGNUM *u1 = BN_CTX_get(ctx.get());
+   BIGNUM *u2 = BN_CTX_get(ctx.get());
+
+   BN_bin2bn(rs, 32, r);
+   BN_bin2bn(rs + 32, 32, s);
+   BN_bin2bn(digest.data(), 32, e);
+
+   std::optional<std::array<char, 33>> result;
+   if (!BN_is_zero(r) && !BN_is_zero(s) && BN_cmp(r, c.order) < 0 && BN_cmp(s, c.order) < 0)
+   {
+      BN_copy(x, r);
+      if (recid & 2)
+      {
+         BN_add(x, x, c.order);
+      }
+
+      point_ptr R(EC_POINT_new(c.group));
+      point_ptr Q(EC_POINT_new(c.group));
+      if (BN_cmp(x, c.field) < 0 &&
+          EC_POINT_set_compressed_coordinates(c.group, R.get(), x, recid & 1, ctx.get()) == 1)
+      {
+         // Q = r^-1 (sR - eG)
+         BN_mod_inverse(rinv, r, c.order, ctx.get());
+         BN_mod_sub(u1, c.order, e, c.order, ctx.get());
+         BN_mod_mul(u1, u1, rinv, c.order, ctx.get());
+         BN_mod_mul(u2, s, rinv, c.order, ctx.get());
+         if (EC_POINT_mul(c.group, Q.get(), u1, R.get(), u2, ctx.get()) == 1 &&
+             !EC_POINT_is_at_infinity(c.group, Q.get()))
+         {
+            result = serialize_point(Q.get(), ctx.get());
+         }
+      }
+   }
+
+   BN_CTX_end(ctx.get());
+   return result;
+}
+
+bool is_canonical(const std::array<char, 65> &sig)
+{
+   auto c = (const uint8_t *)sig.data();
+   return !(c[1] & 0x80) && !(c[1] == 0 && !(c[2] & 0x80)) &&
+          !(c[33] & 0x80) && !(c[33] == 0 && !(c[34] & 0x80));
+}
+
+} // namespace
+
+checksum256 sha256(const char *data, uint32_t length)
+{
+   std::array<uint8_t, 32> hash;
+   SHA256((const unsigned char *)data, length, hash.data());
+   return checksum256(hash);
+}
+
+void assert_sha256(const char *data, uint32_t length, const checksum256 &hash)
+{
+   check(sha256(data, length) == hash, "hash mismatch");
+}
+
+public_key recover_key(const checksum256 &digest, const signature &sig)
+{
+   check(sig.type.value == 0, "unactivated signature type used during recover_key");
+
+   const uint8_t header = uint8_t(sig.data[0]);
+   check(header >= compact_header_base && header < compact_header_base + 4, "unable to reconstruct public key from signature");
+
+   auto recovered = recover(digest.extract_as_byte_array(), (const uint8_t *)sig.data.data() + 1, header - compact_header_base);
+   check(recovered.has_value(), "unable to reconstruct public key from signature");
+
+   public_key pk;
+   pk.type = 0;
+   pk.data = *recovered;
+   return pk;
+}
+
+void assert_recover_key(const checksum256 &digest, const signature &sig, const public_key &pubkey)
+{
+   check(recover_key(digest, sig) == pubkey, "Error expected key different than recovered key");
+}
+
+namespace native
+{
+
+private_key private_key::from_seed(const std::string &seed)
+{
+   return private_key(eosio::sha256(seed.data(), seed.size()).extract_as_byte_array());
+}
+
+private_key::private_key(const std::array<uint8_t, 32> &secret) : _secret(secret)
+{
+   const auto &c = secp256k1();
+   bn_ctx_ptr ctx(BN_CTX_new());
+   BN_CTX_start(ctx.get());
+
+   BIGNUM *k = BN_CTX_get(ctx.get());
+   BN_bin2bn(_secret.data(), 32, k);
+   BN_mod(k, k, c.order, ctx.get());
+   check(!BN_is_zero(k), "invalid private key");
+   BN_bn2binpad(k, _secret.data(), 32);
+
+   point_ptr pub(EC_POINT_new(c.group));
+   EC_POINT_mul(c.group, pub.get(), k, nullptr, nullptr, ctx.get());
+
+   _public.type = 0;
+   _public.data = *serialize_point(pub.get(), ctx.get());
+   BN_CTX_end(ctx.get());
+}
+
+signature private_key::sign(const checksum256 &digest) const
+{
+   const auto &c = secp256k1();
+   const auto hash = digest.extract_as_byte_array();
+
+   std::unique_ptr<EC_KEY, decltype(&EC_KEY_free)> key(EC_KEY_new(), &EC_KEY_free);
+   EC_KEY_set_group(key.get(), c.group);
+   BIGNUM *priv = BN_bin2bn(_secret.data(), 32, nullptr);
+   EC_KEY_set_private_key(key.get(), priv);
+   BN_free(priv);
+
+   for (;;)
+   {
+      std::unique_ptr<ECDSA_SIG, decltype(&ECDSA_SIG_free)> sig(ECDSA_do_sign(hash.data(), hash.size(), key.get()), &ECDSA_SIG_free);
+      check(sig != nullptr, "signing failed");
+
+      const BIGNUM *r = nullptr;
+      const BIGNUM *s = nullptr;
+      ECDSA_SIG_get0(sig.get(), &r, &s);
+
+      BIGNUM *low_s = BN_dup(s);
+      if (BN_cmp(low_s, c.half_order) > 0)
+      {
+         BN_sub(low_s, c.order, low_s);
+      }
+
+      signature out;
+      out.type = 0;
+      uint8_t *rs = (uint8_t *)out.data.data() + 1;
+      BN_bn2binpad(r, rs, 32);
+      BN_bn2binpad(low_s, rs + 32, 32);
+      BN_free(low_s);
+
+      if (!is_canonical(out.data))
+      {
+         continue;
+      }
+
+      for (int recid = 0; recid < 4; ++recid)
+      {
+         auto recovered = recover(hash, rs, recid);
+         if (recovered && *recovered == _public.data)
+         {
+            out.data[0] = char(compact_header_base + recid);
+            return out;
+         }
+      }
+   }
+}
+
+} // namespace native
+} // namespace eosio
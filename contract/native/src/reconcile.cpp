@@ -0,0 +1,749 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#include <native/reconcile.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+namespace eosio
+{
+namespace native
+{
+
+namespace
+{
+
+/// Tables handed to a worker at once; a batch only ends between scopes.
+constexpr size_t batch_bytes = 1 << 20;
+
+/// Unpacks a row with its table's struct; false unless it consumes the row exactly.
+template <typename T>
+bool decode(const row &r, T &value)
+{
+   try
+   {
+      datastream<const char *> ds(r.value.data(), r.value.size());
+      ds >> value;
+      return ds.remaining() == 0;
+   }
+   catch (const std::exception &)
+   {
+      return false;
+   }
+}
+
+bool valid_peos(const asset &quantity)
+{
+   return quantity.is_valid() && quantity.symbol == PEOS_SYMBOL && quantity.amount > 0;
+}
+
+} // namespace
+
+std::string format_amount(int128_t amount, symbol sym)
+{
+   const bool negative = amount < 0;
+   auto abs = negative ? -(uint128_t)amount : (uint128_t)amount;
+   std::string digits;
+   do
+   {
+      digits.insert(digits.begin(), char('0' + int(abs % 10)));
+      abs /= 10;
+   } while (abs > 0);
+
+   const auto precision = sym.precision();
+   if (precision > 0)
+   {
+      if (digits.size() <= precision)
+      {
+         digits.insert(0, precision + 1 - digits.size(), '0');
+      }
+      digits.insert(digits.size() - precision, 1, '.');
+   }
+   return (negative ? "-" : "") + digits + " " + sym.code().to_string();
+}
+
+struct reconciler::scope_state
+{
+   bool started = false;
+   uint64_t code = 0;
+   uint64_t scope = 0;
+   bool legacy_peos = false;
+   bool compact_peos = false;
+   bool reported = false;
+};
+
+struct reconciler::partial
+{
+   uint64_t tables = 0;
+   uint64_t rows = 0;
+   std::map<uint64_t, supply_totals> supplies;
+   custody_totals custody;
+
+   /// Stakes summed by the shard of their owner, next to what the shard rows hold.
+   std::array<int128_t, token::DIVIDEND_SHARDS> owner_stakes{};
+   std::array<int128_t, token::DIVIDEND_SHARDS> shard_staked{};
+   int128_t realized = 0;
+
+   supply_totals &supply(symbol sym)
+   {
+      auto &totals = supplies[sym.raw()];
+      totals.sym = sym;
+      return totals;
+   }
+
+   void merge(const partial &other)
+   {
+      tables += other.tables;
+      rows += other.rows;
+      for (const auto &entry : other.supplies)
+      {
+         const auto &theirs = entry.second;
+         auto &totals = supply(theirs.sym);
+         if (theirs.has_stat)
+         {
+            totals.has_stat = true;
+            totals.supply = theirs.supply;
+         }
+         totals.balances += theirs.balances;
+         totals.holders += theirs.holders;
+      }
+
+      custody.contract_balance += other.custody.contract_balance;
+      custody.staked += other.custody.staked;
+      custody.refunding += other.custody.refunding;
+      custody.utxos += other.custody.utxos;
+      custody.pending_dividends += other.custody.pending_dividends;
+      custody.stakers += other.custody.stakers;
+      custody.refund_tranches += other.custody.refund_tranches;
+      custody.utxo_count += other.custody.utxo_count;
+
+      for (size_t i = 0; i < token::DIVIDEND_SHARDS; ++i)
+      {
+         owner_stakes[i] += other.owner_stakes[i];
+         shard_staked[i] += other.shard_staked[i];
+      }
+      realized += other.realized;
+   }
+};
+
+struct reconciler::batch
+{
+   std::vector<std::vector<char>> records;
+   size_t bytes = 0;
+};
+
+reconciler::reconciler(reconcile_options options) : _options(std::move(options)) {}
+
+void reconciler::report(name owner, name table, std::string message)
+{
+   if (_report_count.fetch_add(1) < _options.max_reports)
+   {
+      std::lock_guard<std::mutex> lock(_reports_mutex);
+      _reports.push_back({owner, table, std::move(message)});
+   }
+}
+
+void reconciler::reset()
+{
+   _has_dividend = false;
+   _has_utxo_global = false;
+   _next_utxo_id = 0;
+   _reports.clear();
+   _report_count = 0;
+}
+
+void reconciler::read_contract_table(const checkpoint_table &tbl)
+{
+   const auto contract = _options.contract;
+   const name table(tbl.table);
+   for (const auto &[pk, r] : tbl.rows)
+   {
+      if (tbl.table == "divtotals"_n.value || tbl.table == "dividends"_n.value)
+      {
+         token::dividend div;
+         token::legacy_dividend legacy;
+         const bool decoded = tbl.table == "divtotals"_n.value ? decode(r, div) : decode(r, legacy);
+         if (decoded && tbl.table == "dividends"_n.value)
+         {
+            div = token::getDividend(legacy);
+         }
+         if (pk != PEOS_SYMBOL.code().raw() || !decoded || div.totalStaked.symbol != PEOS_SYMBOL)
+         {
+            report(contract, table, "row " + std::to_string(pk) + " isn't a PEOS dividend row");
+            continue;
+         }
+         if (_has_dividend)
+         {
+            report(contract, table, "the dividend row is in both divtotals and the legacy dividends table");
+            continue;
+         }
+         _dividend = div;
+         _has_dividend = true;
+      }
+      else
+      {
+         token::utxo_global global;
+         if (pk != 0 || !decode(r, global) || global.id != 0)
+         {
+            report(contract, table, "row " + std::to_string(pk) + " isn't the UTXO counter");
+            continue;
+         }
+         _has_utxo_global = true;
+         _next_utxo_id = global.next_pk;
+      }
+   }
+}
+
+void reconciler::read_contract_rows(const std::string &checkpoint)
+{
+   const auto contract = _options.contract;
+   checkpoint_reader reader(checkpoint);
+
+   table_id id;
+   std::vector<char> record;
+   while (reader.next_id(id))
+   {
+      // tables are ordered by code and scope, so nothing of interest follows the contract's scope
+      if (std::tie(id.code, id.scope) > std::tie(contract.value, contract.value))
+      {
+         break;
+      }
+      if (id.code != contract.value || id.scope != contract.value ||
+          (id.table != "divtotals"_n.value && id.table != "dividends"_n.value && id.table != "utxoglobals"_n.value))
+      {
+         reader.skip();
+         continue;
+      }
+      reader.read(record);
+      read_contract_table(unpack<checkpoint_table>(record));
+   }
+}
+
+void reconciler::check_next(const checkpoint_table &tbl, scope_state &scope, partial &sums)
+{
+   ++sums.tables;
+   sums.rows += tbl.rows.size();
+
+   if (!scope.started || tbl.code != scope.code || tbl.scope != scope.scope)
+   {
+      scope = scope_state{true, tbl.code, tbl.scope};
+   }
+   if (tbl.code == _options.contract.value)
+   {
+      check_table(tbl, scope, sums);
+   }
+
+   if (scope.legacy_peos && scope.compact_peos && !scope.reported)
+   {
+      report(name(tbl.scope), "accts"_n, "has a PEOS balance in both accts and accounts");
+      scope.reported = true;
+   }
+}
+
+void reconciler::check_batch(const batch &work, partial &sums)
+{
+   scope_state scope;
+   for (const auto &record : work.records)
+   {
+      check_next(unpack<checkpoint_table>(record), scope, sums);
+   }
+}
+
+void reconciler::check_table(const checkpoint_table &tbl, scope_state &scope, partial &sums)
+{
+   const name owner(tbl.scope);
+   const name table(tbl.table);
+   const bool contract_scope = tbl.scope == _options.contract.value;
+
+   auto undecodable = [&](uint64_t pk) { report(owner, table, "row " + std::to_string(pk) + " doesn't decode"); };
+   auto add_balance = [&](const asset &balance) {
+      auto &totals = sums.supply(balance.symbol);
+      totals.balances += balance.amount;
+      ++totals.holders;
+      if (contract_scope && balance.symbol == PEOS_SYMBOL)
+      {
+         sums.custody.contract_balance += balance.amount;
+      }
+   };
+
+   switch (tbl.table)
+   {
+   case "accounts"_n.value:
+      for (const auto &[pk, r] : tbl.rows)
+      {
+         token::account a;
+         if (!decode(r, a))
+         {
+            undecodable(pk);
+            continue;
+         }
+         if (!a.balance.is_valid() || a.balance.amount < 0 || pk != a.balance.symbol.code().raw())
+         {
+            report(owner, table, "invalid balance " + a.balance.to_string() + " in row " + std::to_string(pk));
+            continue;
+         }
+         add_balance(a.balance);
+         scope.legacy_peos |= a.balance.symbol == PEOS_SYMBOL;
+      }
+      break;
+
+   case "accts"_n.value:
+      for (const auto &[pk, r] : tbl.rows)
+      {
+         token::compact_account a;
+         if (!decode(r, a) || pk != PEOS_SYMBOL.code().raw())
+         {
+            undecodable(pk);
+            continue;
+         }
+         const auto balance = token::getAccountBalance(a);
+         if (!balance.is_valid())
+         {
+            report(owner, table, "invalid balance " + balance.to_string());
+            continue;
+         }
+         add_balance(balance);
+         scope.compact_peos = true;
+      }
+      break;
+
+   case "stakes"_n.value:
+   case "staked"_n.value:
+      for (const auto &[pk, r] : tbl.rows)
+      {
+         token::user_staked stake;
+         token::legacy_stake legacy;
+         const bool fixed = tbl.table == "stakes"_n.value;
+         if (!(fixed ? decode(r, stake) : decode(r, legacy)))
+         {
+            undecodable(pk);
+            continue;
+         }
+         if (!fixed)
+         {
+            stake = token::getStake(legacy);
+         }
+         if (!valid_peos(stake.quantity) || pk != stake.quantity.symbol.code().raw())
+         {
+            report(owner, table, "invalid stake " + stake.quantity.to_string());
+            continue;
+         }
+         sums.custody.staked += stake.quantity.amount;
+         ++sums.custody.stakers;
+         sums.owner_stakes[token::getDividendShardId(owner)] += stake.quantity.amount;
+
+         if (_has_dividend)
+         {
+            if (stake.lastDividendsPerShare > _dividend.dividendsPerShare)
+            {
+               report(owner, table, "lastDividendsPerShare is ahead of the dividend row");
+               continue;
+            }
+            sums.custody.pending_dividends += token::getDividendShare(_dividend, stake);
+         }
+      }
+      break;
+
+   case "refunds"_n.value:
+      for (const auto &[pk, r] : tbl.rows)
+      {
+         token::refund_request request;
+         if (!decode(r, request))
+         {
+            undecodable(pk);
+            continue;
+         }
+         if (!valid_peos(request.amount) || pk != owner.value || request.owner != owner)
+         {
+            report(owner, table, "invalid refund of " + request.amount.to_string() + " to " + request.owner.to_string());
+            continue;
+         }
+         sums.custody.refunding += request.amount.amount;
+         ++sums.custody.refund_tranches;
+      }
+      break;
+
+   case "stat"_n.value:
+      for (const auto &[pk, r] : tbl.rows)
+      {
+         token::currency_stats st;
+         if (!decode(r, st))
+         {
+            undecodable(pk);
+            continue;
+         }
+         const auto sym = st.supply.symbol;
+         if (pk != tbl.scope || pk != sym.code().raw() || !st.supply.is_valid() || !st.max_supply.is_valid() ||
+             st.max_supply.symbol != sym || st.supply.amount < 0 || st.supply > st.max_supply)
+         {
+            report(owner, table, "invalid supply " + st.supply.to_string() + " of max " + st.max_supply.to_string());
+            continue;
+         }
+         auto &totals = sums.supply(sym);
+         totals.has_stat = true;
+         totals.supply = st.supply.amount;
+      }
+      break;
+
+   case "refundqueue"_n.value:
+   {
+      if (!contract_scope)
+      {
+         break;
+      }
+      // per owner the tranche count and the newest request time; ids follow request order
+      std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> owners;
+      for (const auto &[pk, r] : tbl.rows)
+      {
+         token::refund_entry entry;
+         if (!decode(r, entry) || pk != entry.id)
+         {
+            undecodable(pk);
+            continue;
+         }
+         if (!valid_peos(entry.amount))
+         {
+            report(entry.owner, table, "invalid refund " + entry.amount.to_string() + " in tranche " + std::to_string(pk));
+            continue;
+         }
+         sums.custody.refunding += entry.amount.amount;
+         ++sums.custody.refund_tranches;
+
+         auto &tranches = owners[entry.owner.value];
+         if (tranches.first > 0 && entry.request_time < tranches.second)
+         {
+            report(entry.owner, table, "tranche " + std::to_string(pk) + " was requested before an older tranche");
+         }
+         ++tranches.first;
+         tranches.second = std::max(tranches.second, entry.request_time);
+      }
+      for (const auto &[holder, tranches] : owners)
+      {
+         if (tranches.first > token::MAX_REFUND_TRANCHES)
+         {
+            report(name(holder), table, std::to_string(tranches.first) + " refund tranches, more than " +
+                                            std::to_string(token::MAX_REFUND_TRANCHES));
+         }
+      }
+      break;
+   }
+
+   case "utxos"_n.value:
+      if (!contract_scope)
+      {
+         break;
+      }
+      for (const auto &[pk, r] : tbl.rows)
+      {
+         token::utxo u;
+         if (!decode(r, u) || pk != u.id)
+         {
+            undecodable(pk);
+            continue;
+         }
+         if (!valid_peos(u.amount))
+         {
+            report(owner, table, "invalid amount " + u.amount.to_string() + " in UTXO " + std::to_string(pk));
+            continue;
+         }
+         if (_has_utxo_global && u.id >= _next_utxo_id)
+         {
+            report(owner, table, "UTXO " + std::to_string(pk) + " isn't below the next id " + std::to_string(_next_utxo_id));
+         }
+         sums.custody.utxos += u.amount.amount;
+         ++sums.custody.utxo_count;
+      }
+      break;
+
+   case "divshards"_n.value:
+      if (!contract_scope)
+      {
+         break;
+      }
+      for (const auto &[pk, r] : tbl.rows)
+      {
+         token::dividend_shard shard;
+         if (!decode(r, shard) || pk != shard.id || shard.id >= token::DIVIDEND_SHARDS)
+         {
+            undecodable(pk);
+            continue;
+         }
+         if (shard.staked.symbol != PEOS_SYMBOL || shard.realized.symbol != PEOS_SYMBOL || shard.realized.amount < 0)
+         {
+            report(owner, table, "invalid shard " + std::to_string(pk));
+            continue;
+         }
+         sums.shard_staked[shard.id] += shard.staked.amount;
+         sums.realized += shard.realized.amount;
+      }
+      break;
+   }
+}
+
+void reconciler::check_totals(partial &sums, reconcile_report &result)
+{
+   const auto contract = _options.contract;
+
+   for (const auto &entry : sums.supplies)
+   {
+      const auto &totals = entry.second;
+      if (!totals.has_stat)
+      {
+         report(contract, "stat"_n,
+                "balances of " + format_amount(totals.balances, totals.sym) + " in a symbol without a stat row");
+      }
+      else if (totals.balances != totals.supply)
+      {
+         report(contract, "stat"_n,
+                "supply is " + format_amount(totals.supply, totals.sym) + " but balances add up to " +
+                   format_amount(totals.balances, totals.sym));
+      }
+      result.supplies.push_back(totals);
+   }
+
+   auto &custody = sums.custody;
+   if (_has_dividend)
+   {
+      int128_t shard_staked = 0;
+      for (auto staked : sums.shard_staked)
+      {
+         shard_staked += staked;
+      }
+      if (custody.staked != _dividend.totalStaked.amount + shard_staked)
+      {
+         report(contract, "divshards"_n,
+                "stakes add up to " + format_amount(custody.staked, PEOS_SYMBOL) + " but the dividend row and shards to " +
+                   format_amount(_dividend.totalStaked.amount + shard_staked, PEOS_SYMBOL));
+      }
+      // with no stake left in the dividend row, every shard holds exactly its owners' stakes
+      if (_dividend.totalStaked.amount == 0)
+      {
+         for (size_t i = 0; i < token::DIVIDEND_SHARDS; ++i)
+         {
+            if (sums.owner_stakes[i] != sums.shard_staked[i])
+            {
+               report(contract, "divshards"_n,
+                      "shard " + std::to_string(i) + " holds " + format_amount(sums.shard_staked[i], PEOS_SYMBOL) +
+                         " but its owners stake " + format_amount(sums.owner_stakes[i], PEOS_SYMBOL));
+            }
+         }
+      }
+
+      custody.unclaimed_dividends = _dividend.totalUnclaimedDividends.amount - sums.realized;
+      custody.owed_dividends = _dividend.totalDividends.amount - sums.realized;
+      if (_dividend.totalDividends > _dividend.totalUnclaimedDividends || custody.owed_dividends < 0)
+      {
+         report(contract, "divtotals"_n,
+                format_amount(sums.realized, PEOS_SYMBOL) + " realized of " + _dividend.totalDividends.to_string() +
+                   " distributed to stakers and " + _dividend.totalUnclaimedDividends.to_string() + " in total");
+      }
+      else if (custody.pending_dividends > custody.owed_dividends)
+      {
+         report(contract, "divtotals"_n,
+                "stakers could realize " + format_amount(custody.pending_dividends, PEOS_SYMBOL) + " but only " +
+                   format_amount(custody.owed_dividends, PEOS_SYMBOL) + " is owed to them");
+      }
+   }
+   else if (custody.stakers > 0 || sums.realized != 0)
+   {
+      report(contract, "divtotals"_n, "stakes or realized dividends exist without a dividend row");
+   }
+
+   if (custody.utxo_count > 0 && !_has_utxo_global)
+   {
+      report(contract, "utxoglobals"_n, "UTXOs exist without the UTXO counter");
+   }
+
+   if (custody.contract_balance < custody.liabilities())
+   {
+      report(contract, "accounts"_n,
+             "the contract holds " + format_amount(custody.contract_balance, PEOS_SYMBOL) + " but owes " +
+                format_amount(custody.liabilities(), PEOS_SYMBOL));
+   }
+   result.custody = custody;
+}
+
+reconcile_report reconciler::check(const std::string &checkpoint)
+{
+   const auto started = std::chrono::steady_clock::now();
+   reset();
+
+   // stakers' pending dividends need the dividend row, which sits in a late scope
+   read_contract_rows(checkpoint);
+
+   checkpoint_reader reader(checkpoint);
+   const unsigned threads =
+      _options.threads ? _options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+   std::mutex mutex;
+   std::condition_variable ready;
+   std::condition_variable drained;
+   std::deque<batch> queue;
+   size_t queued_bytes = 0;
+   bool done = false;
+   bool failed = false;
+
+   std::vector<partial> sums(threads);
+   std::vector<std::exception_ptr> errors(threads + 1);
+   std::vector<std::thread> workers;
+   for (unsigned t = 0; t < threads; ++t)
+   {
+      workers.emplace_back([&, t] {
+         try
+         {
+            for (;;)
+            {
+               batch work;
+               {
+                  std::unique_lock<std::mutex> lock(mutex);
+                  ready.wait(lock, [&] { return done || failed || !queue.empty(); });
+                  if (failed || queue.empty())
+                  {
+                     return;
+                  }
+                  work = std::move(queue.front());
+                  queue.pop_front();
+                  queued_bytes -= work.bytes;
+               }
+               drained.notify_one();
+               check_batch(work, sums[t]);
+            }
+         }
+         catch (...)
+         {
+            errors[t] = std::current_exception();
+            std::lock_guard<std::mutex> lock(mutex);
+            failed = true;
+            drained.notify_all();
+            ready.notify_all();
+         }
+      });
+   }
+
+   auto push = [&](batch &work) {
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         drained.wait(lock, [&] { return failed || queued_bytes < _options.read_ahead; });
+         if (failed)
+         {
+            return false;
+         }
+         queued_bytes += work.bytes;
+         queue.push_back(std::move(work));
+      }
+      ready.notify_one();
+      work = batch();
+      return true;
+   };
+
+   try
+   {
+      batch work;
+      table_id id;
+      table_id last;
+      bool open = true;
+      while (open && reader.next_id(id))
+      {
+         // all tables of a scope go to the same worker
+         if (work.bytes >= batch_bytes && (id.code != last.code || id.scope != last.scope))
+         {
+            open = push(work);
+         }
+         work.records.emplace_back();
+         reader.read(work.records.back());
+         work.bytes += work.records.back().size();
+         last = id;
+      }
+      if (open && !work.records.empty())
+      {
+         push(work);
+      }
+   }
+   catch (...)
+   {
+      errors[threads] = std::current_exception();
+   }
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      done = true;
+   }
+   ready.notify_all();
+   for (auto &worker : workers)
+   {
+      worker.join();
+   }
+   for (auto &error : errors)
+   {
+      if (error)
+      {
+         std::rethrow_exception(error);
+      }
+   }
+
+   partial total;
+   for (const auto &part : sums)
+   {
+      total.merge(part);
+   }
+   return finish(total, reader.info().position, started);
+}
+
+reconcile_report reconciler::check(const database &db)
+{
+   const auto started = std::chrono::steady_clock::now();
+   reset();
+
+   const auto contract = _options.contract.value;
+   for (auto table : {"divtotals"_n, "dividends"_n, "utxoglobals"_n})
+   {
+      auto itr = db.tables().find({contract, contract, table.value});
+      if (itr != db.tables().end())
+      {
+         read_contract_table({contract, contract, table.value, {itr->second.rows.begin(), itr->second.rows.end()}});
+      }
+   }
+
+   partial sums;
+   scope_state scope;
+   for (const auto &[id, tbl] : db.tables())
+   {
+      // erased tables linger empty in the database, but not on chain
+      if (!tbl.rows.empty())
+      {
+         check_next({id.code, id.scope, id.table, {tbl.rows.begin(), tbl.rows.end()}}, scope, sums);
+      }
+   }
+   return finish(sums, 0, started);
+}
+
+reconcile_report reconciler::finish(partial &sums, uint64_t position, std::chrono::steady_clock::time_point started)
+{
+   reconcile_report result;
+   result.position = position;
+   result.tables = sums.tables;
+   result.rows = sums.rows;
+   check_totals(sums, result);
+
+   result.discrepancies = std::move(_reports);
+   _reports.clear();
+   result.discrepancy_count = _report_count;
+   std::sort(result.discrepancies.begin(), result.discrepancies.end(), [](const discrepancy &a, const discrepancy &b) {
+      return std::tie(a.owner.value, a.table.value, a.message) < std::tie(b.owner.value, b.table.value, b.message);
+   });
+
+   result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+   return result;
+}
+
+} // namespace native
+} // namespace eosio
@@ -0,0 +1,106 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#include <native/replay.hpp>
+
+#include <native/checkpoint.hpp>
+
+#include <token.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+// the contract's entry point, defined by EOSIO_DISPATCH
+extern "C" void apply(uint64_t receiver, uint64_t code, uint64_t action);
+
+namespace eosio
+{
+namespace native
+{
+
+replayer::replayer(name contract, bool legacy_budgets)
+{
+   _chain.set_implicit_accounts(true);
+   _chain.set_code(contract, &::apply);
+   if (legacy_budgets)
+   {
+      seed_legacy_budgets(contract);
+   }
+}
+
+void replayer::seed_legacy_budgets(name contract)
+{
+   const std::vector<permission_level> auth = {{contract, "active"_n}};
+   auto peos = [](int64_t amount) { return asset(amount, PEOS_SYMBOL); };
+
+   // marketing, the team fund over 400 days from 2019-02-25, and the contract's routed allocations
+   _chain.push(contract, "setvesting"_n, auth, "peosmarketin"_n, peos(50'000'000'0000ll), 0u, 0u, 0u, 0u);
+   _chain.push(contract, "setvesting"_n, auth, "peosteamfund"_n, peos(200'000'000'0000ll), 1551096000u, 0u,
+               uint32_t(400 * 24 * 3600), 0u);
+   _chain.push(contract, "setvesting"_n, auth, contract, peos(596'224'1696ll), 0u, 0u, 0u, 0u);
+}
+
+uint64_t replayer::resume(const std::string &checkpoint)
+{
+   _position = load_checkpoint(checkpoint, _chain);
+   return _position;
+}
+
+std::string replayer::checkpoint_path(const std::string &dir, uint64_t position)
+{
+   char file[48];
+   snprintf(file, sizeof(file), "/checkpoint-%012llu.bin", (unsigned long long)position);
+   return dir + file;
+}
+
+replay_stats replayer::replay(action_log_reader &log, const replay_options &options)
+{
+   if (log.position() < _position && !log.skip(_position - log.position()))
+   {
+      throw std::runtime_error("action log ends before the checkpoint's position " + std::to_string(_position));
+   }
+
+   replay_stats stats;
+   const auto started = std::chrono::steady_clock::now();
+
+   logged_action entry;
+   while ((!options.limit || stats.applied + stats.failed < options.limit) && log.next(entry))
+   {
+      _chain.set_time(entry.block_time);
+      try
+      {
+         _chain.push_action(entry.act);
+         ++stats.applied;
+      }
+      catch (const std::exception &e)
+      {
+         ++stats.failed;
+         if (_on_failure)
+         {
+            _on_failure(log.position() - 1, entry, e);
+         }
+         if (options.stop_on_error)
+         {
+            _position = log.position();
+            throw;
+         }
+      }
+      _position = log.position();
+
+      if (options.checkpoint_interval && _position % options.checkpoint_interval == 0)
+      {
+         save_checkpoint(checkpoint_path(options.checkpoint_dir, _position), _chain, _position);
+         ++stats.checkpoints;
+      }
+   }
+
+   stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+   return stats;
+}
+
+} // namespace native
+} // namespace eosio
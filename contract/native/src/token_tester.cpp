@@ -0,0 +1,274 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#include <native/token_tester.hpp>
+
+#include <algorithm>
+#include <array>
+
+namespace eosio
+{
+namespace native
+{
+
+namespace
+{
+
+#pragma pack(push,1)
+struct sign_data {
+   uint64_t id;
+   checksum256 outputsDigest;
+};
+
+struct drop_leaf {
+   uint64_t owner;
+   int64_t amount;
+   uint64_t symbol;
+};
+#pragma pack(pop)
+
+} // namespace
+
+token_tester::token_tester(uint32_t time)
+{
+   _chain.set_time(time);
+   _chain.set_code(contract_account, &::apply);
+   create_accounts({marketing_account, teamfund_account});
+
+   _chain.push(contract_account, "create"_n, active(contract_account),
+               contract_account, peos(10'000'000'000'0000ll));
+
+   // the budgets the contract used to hard-code
+   set_vesting(marketing_account, peos(50'000'000'0000ll));
+   set_vesting(teamfund_account, peos(200'000'000'0000ll), 1551096000, 0, 400 * 24 * 3600);
+   set_vesting(contract_account, peos(596'224'1696ll));
+}
+
+void token_tester::set_vesting(name account, asset total, uint32_t start, uint32_t cliff, uint32_t duration,
+                               uint32_t step)
+{
+   _chain.push(contract_account, "setvesting"_n, active(contract_account), account, total, start, cliff,
+               duration, step);
+}
+
+name token_tester::account_name(uint64_t index)
+{
+   // 'a' prefix keeps names valid; the index is spelled with the 32-symbol name alphabet.
+   static const char *charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+   std::string s = "a";
+   do
+   {
+      s += charmap[1 + index % 31];
+      index /= 31;
+   } while (index && s.size() < 12);
+   return name(s);
+}
+
+void token_tester::create_accounts(std::initializer_list<name> accounts)
+{
+   for (auto account : accounts)
+   {
+      _chain.create_account(account);
+   }
+}
+
+void token_tester::fund(name owner, asset quantity)
+{
+   issue(marketing_account, quantity);
+   transfer(marketing_account, owner, quantity);
+   claim(owner);
+}
+
+void token_tester::issue(name to, asset quantity, const std::string &memo)
+{
+   _chain.push(contract_account, "issue"_n, active(contract_account), to, quantity, memo);
+}
+
+void token_tester::issuemany(const std::vector<token::recipient> &recipients, const std::string &memo)
+{
+   _chain.push(contract_account, "issuemany"_n, active(contract_account), recipients, memo);
+}
+
+void token_tester::transfer(name from, name to, asset quantity, const std::string &memo)
+{
+   _chain.push(contract_account, "transfer"_n, active(from), from, to, quantity, memo);
+}
+
+void token_tester::transfermany(name from, const std::vector<token::recipient> &recipients, const std::string &memo)
+{
+   _chain.push(contract_account, "transfermany"_n, active(from), from, recipients, memo);
+}
+
+void token_tester::claim(name owner)
+{
+   _chain.push(contract_account, "claim"_n, active(owner), owner, PEOS_SYMBOL.code());
+}
+
+void token_tester::setdroproot(const checksum256 &root)
+{
+   _chain.push(contract_account, "setdroproot"_n, active(contract_account), PEOS_SYMBOL.code(), root);
+}
+
+void token_tester::claimdrop(name owner, asset quantity, const std::vector<checksum256> &proof)
+{
+   _chain.push(contract_account, "claimdrop"_n, active(owner), owner, quantity, proof);
+}
+
+checksum256 token_tester::drop_leaf_hash(name owner, asset quantity)
+{
+   drop_leaf leaf = {owner.value, quantity.amount, quantity.symbol.raw()};
+   return sha256((const char *)&leaf, sizeof(drop_leaf));
+}
+
+checksum256 token_tester::drop_node_hash(const checksum256 &a, const checksum256 &b)
+{
+   auto left = a.extract_as_byte_array();
+   auto right = b.extract_as_byte_array();
+   if (right < left)
+   {
+      std::swap(left, right);
+   }
+   std::array<uint8_t, 64> node;
+   std::copy(left.begin(), left.end(), node.begin());
+   std::copy(right.begin(), right.end(), node.begin() + 32);
+   return sha256((const char *)node.data(), node.size());
+}
+
+void token_tester::recover(name owner)
+{
+   _chain.push(contract_account, "recover"_n, active(contract_account), owner, PEOS_SYMBOL.code());
+}
+
+void token_tester::recovermany(const std::vector<name> &owners)
+{
+   _chain.push(contract_account, "recovermany"_n, active(contract_account), owners, PEOS_SYMBOL.code());
+}
+
+void token_tester::migrateaccts(const std::vector<name> &owners)
+{
+   _chain.push(contract_account, "migrateaccts"_n, active(contract_account), owners);
+}
+
+void token_tester::migratestake(const std::vector<name> &owners)
+{
+   _chain.push(contract_account, "migratestake"_n, active(contract_account), owners);
+}
+
+void token_tester::stake(name owner, asset quantity)
+{
+   _chain.push(contract_account, "stake"_n, active(owner), owner, quantity);
+}
+
+void token_tester::unstake(name owner, asset quantity)
+{
+   _chain.push(contract_account, "unstake"_n, active(owner), owner, quantity);
+}
+
+void token_tester::realizediv(name owner)
+{
+   _chain.push(contract_account, "realizediv"_n, active(owner), owner);
+}
+
+void token_tester::refund(name owner)
+{
+   _chain.push(contract_account, "refund"_n, active(owner), owner);
+}
+
+void token_tester::procrefunds(uint32_t max, name cranker)
+{
+   _chain.push(contract_account, "procrefunds"_n, active(cranker), max);
+}
+
+void token_tester::distribute(name owner, asset quantity)
+{
+   _chain.push(contract_account, "distribute"_n, active(owner), owner, quantity);
+}
+
+std::string token_tester::pendingdiv(name owner)
+{
+   return console_of("pendingdiv"_n, owner);
+}
+
+std::string token_tester::getaccounts(const std::vector<name> &owners)
+{
+   return console_of("getaccounts"_n, owners);
+}
+
+void token_tester::loadutxo(name from, const public_key &pk, asset quantity)
+{
+   _chain.push(contract_account, "loadutxo"_n, active(from), from, pk, quantity);
+}
+
+void token_tester::transferutxo(name payer, const std::vector<token::input> &inputs,
+                                const std::vector<token::output> &outputs, const std::string &memo)
+{
+   _chain.push(contract_account, "transferutxo"_n, active(payer), payer, inputs, outputs, memo);
+}
+
+void token_tester::transferkeys(name payer, const std::vector<token::keyinput> &inputs,
+                                const std::vector<token::output> &outputs, const std::string &memo)
+{
+   _chain.push(contract_account, "transferkeys"_n, active(payer), payer, inputs, outputs, memo);
+}
+
+void token_tester::sweeputxo(name payer, const public_key &pk, uint32_t max, const signature &sig)
+{
+   _chain.push(contract_account, "sweeputxo"_n, active(payer), payer, pk, max, sig);
+}
+
+checksum256 token_tester::utxo_digest(uint64_t id, const std::vector<token::output> &outputs)
+{
+   auto p = pack(outputs);
+   sign_data sd = {id, sha256(p.data(), p.size())};
+   return sha256((const char *)&sd, sizeof(sign_data));
+}
+
+checksum256 token_tester::utxo_key_digest(const std::vector<uint64_t> &ids, const std::vector<token::output> &outputs)
+{
+   auto p = pack(outputs);
+   auto signed_data = pack(std::make_tuple(ids, sha256(p.data(), p.size())));
+   return sha256(signed_data.data(), signed_data.size());
+}
+
+checksum256 token_tester::utxo_sweep_digest(uint64_t first_id, uint32_t max)
+{
+   auto signed_data = pack(std::make_tuple(first_id, max));
+   return sha256(signed_data.data(), signed_data.size());
+}
+
+uint64_t token_tester::next_utxo_id() const
+{
+   const auto *row = _chain.db().find({contract_account.value, contract_account.value, "utxoglobals"_n.value}, 0);
+   if (!row)
+   {
+      return 0;
+   }
+   // utxo_global is (id, next_pk)
+   return unpack<std::pair<uint64_t, uint64_t>>(row->value).second;
+}
+
+asset token_tester::balance(name owner) const
+{
+   // compact rows pack the claimed flag into the top bit of the amount
+   const auto *row = _chain.db().find({contract_account.value, owner.value, "accts"_n.value},
+                                      PEOS_SYMBOL.code().raw());
+   if (row)
+   {
+      return peos(int64_t(unpack<uint64_t>(row->value) & ~(1ull << 63)));
+   }
+   row = _chain.db().find({contract_account.value, owner.value, "accounts"_n.value},
+                          PEOS_SYMBOL.code().raw());
+   return row ? unpack<asset>(row->value) : peos(0);
+}
+
+asset token_tester::supply() const
+{
+   const auto *row = _chain.db().find({contract_account.value, PEOS_SYMBOL.code().raw(), "stat"_n.value},
+                                      PEOS_SYMBOL.code().raw());
+   return row ? unpack<asset>(row->value) : peos(0);
+}
+
+} // namespace native
+} // namespace eosio
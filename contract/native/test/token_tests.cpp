@@ -0,0 +1,348 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Behavioural tests of the token contract on the native chain. Every case
+ *  starts from a fresh token_tester; the binary prints each failure and
+ *  exits with 1 if there was any. Run through ctest, or directly with case
+ *  names to run only those.
+ */
+
+#include <native/keys.hpp>
+#include <native/reconcile.hpp>
+#include <native/token_tester.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+using namespace eosio::native;
+
+namespace
+{
+
+struct test_case
+{
+   const char *name;
+   void (*run)();
+};
+
+std::vector<test_case> &test_cases()
+{
+   static std::vector<test_case> cases;
+   return cases;
+}
+
+struct test_registrar
+{
+   test_registrar(const char *name, void (*run)()) { test_cases().push_back({name, run}); }
+};
+
+#define TOKEN_TEST(name)                                    \
+   void name();                                             \
+   const test_registrar name##_registrar{#name, name};      \
+   void name()
+
+void require(bool condition, const std::string &what)
+{
+   if (!condition)
+   {
+      throw std::runtime_error(what);
+   }
+}
+
+void require_equal(const asset &actual, const asset &expected, const std::string &what)
+{
+   require(actual == expected, what + ": " + actual.to_string() + " instead of " + expected.to_string());
+}
+
+/// Runs `f`, which must fail a contract check() whose message contains `message`.
+void require_check(const std::function<void()> &f, const std::string &message)
+{
+   try
+   {
+      f();
+   }
+   catch (const assert_exception &e)
+   {
+      require(std::string(e.what()).find(message) != std::string::npos,
+              "expected \"" + message + "\", got \"" + e.what() + "\"");
+      return;
+   }
+   throw std::runtime_error("expected \"" + message + "\", but the action succeeded");
+}
+
+// --- claimdrop ---
+
+constexpr name alice = "alice"_n;
+constexpr name bob = "bob"_n;
+
+/// Publishes a two-leaf drop for alice and bob and funds the issuer with both allocations.
+struct drop_fixture
+{
+   token_tester t;
+   asset alice_amount = token_tester::peos(100'0000);
+   asset bob_amount = token_tester::peos(250'0000);
+   checksum256 alice_leaf = token_tester::drop_leaf_hash(alice, alice_amount);
+   checksum256 bob_leaf = token_tester::drop_leaf_hash(bob, bob_amount);
+
+   drop_fixture()
+   {
+      t.create_accounts({alice, bob});
+      t.issue(token_tester::contract_account, alice_amount + bob_amount);
+      t.setdroproot(token_tester::drop_node_hash(alice_leaf, bob_leaf));
+   }
+};
+
+TOKEN_TEST(claimdrop_pays_a_valid_proof)
+{
+   drop_fixture f;
+   f.t.claimdrop(alice, f.alice_amount, {f.bob_leaf});
+   f.t.claimdrop(bob, f.bob_amount, {f.alice_leaf});
+
+   require_equal(f.t.balance(alice), f.alice_amount, "alice's balance");
+   require_equal(f.t.balance(bob), f.bob_amount, "bob's balance");
+   require_equal(f.t.balance(token_tester::contract_account), token_tester::peos(0), "issuer's balance");
+}
+
+TOKEN_TEST(claimdrop_rejects_a_bad_proof)
+{
+   drop_fixture f;
+   require_check([&] { f.t.claimdrop(alice, f.alice_amount, {f.alice_leaf}); }, "invalid airdrop proof");
+   require_check([&] { f.t.claimdrop(alice, f.alice_amount, {}); }, "invalid airdrop proof");
+   require_check([&] { f.t.claimdrop(bob, f.alice_amount, {f.bob_leaf}); }, "invalid airdrop proof");
+   require_equal(f.t.balance(alice), token_tester::peos(0), "alice's balance");
+}
+
+TOKEN_TEST(claimdrop_rejects_a_wrong_amount)
+{
+   drop_fixture f;
+   require_check([&] { f.t.claimdrop(alice, f.alice_amount + token_tester::peos(1), {f.bob_leaf}); },
+                 "invalid airdrop proof");
+   require_check([&] { f.t.claimdrop(alice, f.bob_amount, {f.bob_leaf}); }, "invalid airdrop proof");
+   require_equal(f.t.balance(alice), token_tester::peos(0), "alice's balance");
+}
+
+TOKEN_TEST(claimdrop_pays_only_once)
+{
+   drop_fixture f;
+   f.t.issue(token_tester::contract_account, f.alice_amount);
+   f.t.claimdrop(alice, f.alice_amount, {f.bob_leaf});
+   require_check([&] { f.t.claimdrop(alice, f.alice_amount, {f.bob_leaf}); }, "airdrop already claimed");
+   require_equal(f.t.balance(alice), f.alice_amount, "alice's balance");
+}
+
+TOKEN_TEST(claimdrop_claims_an_unclaimed_row)
+{
+   drop_fixture f;
+   // an issuer-paid transfer leaves alice with an unclaimed row the issuer may recover
+   const auto transferred = token_tester::peos(5'0000);
+   f.t.issue(token_tester::contract_account, transferred);
+   f.t.transfer(token_tester::contract_account, alice, transferred);
+
+   f.t.claimdrop(alice, f.alice_amount, {f.bob_leaf});
+   f.t.recover(alice);
+
+   require_equal(f.t.balance(alice), f.alice_amount + transferred, "alice's balance after recover");
+   require(f.t.get_chain().ram_usage(alice) > 0, "alice doesn't pay for the row");
+}
+
+// --- vesting ---
+
+constexpr name dave = "dave"_n;
+constexpr uint32_t day = 24 * 3600;
+
+/// dave vests 1000 PEOS over 100 days from the default time, in 10-day steps after a 30-day cliff.
+struct vesting_fixture
+{
+   token_tester t;
+   uint32_t start = token_tester::default_time;
+
+   vesting_fixture()
+   {
+      t.create_account(dave);
+      t.set_vesting(dave, token_tester::peos(1000'0000), start, 30 * day, 100 * day, 10 * day);
+   }
+
+   void at(uint32_t seconds) { t.get_chain().set_time(start + seconds); }
+
+   /// Issues `vested` to dave, then checks that a single unit more is refused.
+   void require_vested(const asset &vested)
+   {
+      if (vested.amount > 0)
+      {
+         t.issue(dave, vested);
+      }
+      require_check([&] { t.issue(dave, token_tester::peos(1)); }, "issuance exceeds vested budget of dave");
+      require_equal(t.balance(dave), vested, "dave's balance");
+   }
+};
+
+TOKEN_TEST(vesting_before_the_cliff)
+{
+   vesting_fixture f;
+   f.at(30 * day - 1);
+   f.require_vested(token_tester::peos(0));
+}
+
+TOKEN_TEST(vesting_at_the_cliff)
+{
+   vesting_fixture f;
+   f.at(30 * day);
+   f.require_vested(token_tester::peos(300'0000));
+}
+
+TOKEN_TEST(vesting_partway_through_a_step)
+{
+   vesting_fixture f;
+   f.at(35 * day);
+   f.require_vested(token_tester::peos(300'0000));
+
+   f.at(40 * day);
+   f.t.issue(dave, token_tester::peos(100'0000));
+   require_check([&] { f.t.issue(dave, token_tester::peos(1)); }, "issuance exceeds vested budget of dave");
+}
+
+TOKEN_TEST(vesting_after_the_end)
+{
+   vesting_fixture f;
+   f.at(150 * day);
+   f.require_vested(token_tester::peos(1000'0000));
+}
+
+TOKEN_TEST(issuemany_rejects_more_than_vested)
+{
+   vesting_fixture f;
+   f.at(30 * day);
+   // split entries for one account are merged before the budget check
+   require_check([&] { f.t.issuemany({{dave, token_tester::peos(200'0000)}, {dave, token_tester::peos(100'0001)}}); },
+                 "issuance exceeds vested budget of dave");
+   require_equal(f.t.balance(dave), token_tester::peos(0), "dave's balance");
+
+   f.t.issuemany({{dave, token_tester::peos(200'0000)}, {dave, token_tester::peos(100'0000)}});
+   require_equal(f.t.balance(dave), token_tester::peos(300'0000), "dave's balance");
+}
+
+// --- legacy stakes ---
+
+/// Writes a row as an older version of the contract left it.
+template <typename T>
+void plant(token_tester &t, name scope, name table, name payer, const T &value)
+{
+   row r;
+   r.payer = payer.value;
+   r.value = pack(value);
+   t.get_chain().db().restore({token_tester::contract_account.value, scope.value, table.value},
+                              PEOS_SYMBOL.code().raw(), std::move(r));
+}
+
+bool has_row(token_tester &t, name scope, name table)
+{
+   return t.get_chain().db().find({token_tester::contract_account.value, scope.value, table.value},
+                                  PEOS_SYMBOL.code().raw()) != nullptr;
+}
+
+bool reconciles(token_tester &t) { return reconciler{}.check(t.get_chain().db()).ok(); }
+
+TOKEN_TEST(migratestake_converts_legacy_stakes)
+{
+   token_tester t;
+   const name carol = "carol"_n;
+   const auto contract = token_tester::contract_account;
+   t.create_accounts({alice, bob, carol});
+   for (auto owner : {alice, bob, carol})
+   {
+      t.fund(owner, token_tester::peos(1000'0000));
+   }
+
+   // alice staked 100 and bob 200 under the double layout, then 50 were distributed
+   t.transfer(alice, contract, token_tester::peos(100'0000));
+   t.transfer(bob, contract, token_tester::peos(200'0000));
+   t.transfer(carol, contract, token_tester::peos(50'0000));
+   plant(t, contract, "dividends"_n, contract,
+         std::make_tuple(token_tester::peos(300'0000), token_tester::peos(50'0000), token_tester::peos(50'0000),
+                         1.0 + 50.0 / 300.0));
+   plant(t, alice, "staked"_n, alice, std::make_tuple(token_tester::peos(100'0000), 1.0));
+   plant(t, bob, "staked"_n, bob, std::make_tuple(token_tester::peos(200'0000), 1.0));
+   require(reconciles(t), "legacy rows don't reconcile");
+
+   // staking actions no longer read legacy stakes
+   require_check([&] { t.unstake(bob, token_tester::peos(200'0000)); }, "nothing staked");
+
+   // alice stakes again before being migrated, which moves the dividend row
+   t.stake(alice, token_tester::peos(10'0000));
+   require(has_row(t, contract, "divtotals"_n) && !has_row(t, contract, "dividends"_n), "dividend row not moved");
+   t.distribute(carol, token_tester::peos(31'0000));
+   require(reconciles(t), "ledger doesn't reconcile before migrating");
+
+   const auto alice_before = t.balance(alice);
+   const auto bob_before = t.balance(bob);
+   t.migratestake({alice, bob, carol});
+   require(!has_row(t, alice, "staked"_n) && !has_row(t, bob, "staked"_n), "legacy stakes left behind");
+   require(reconciles(t), "ledger doesn't reconcile after migrating");
+
+   // alice: 100 * (50/300 + 31/310) on the legacy part, 10 * 31/310 on the new one, each floored
+   require_equal(t.balance(alice) - alice_before, token_tester::peos(26'6666 + 9999), "alice's dividends");
+   require(t.getaccounts({alice}).find("\"staked\":\"110.0000 PEOS\"") != std::string::npos, "alice's stake");
+
+   // bob: 200 * (50/300 + 31/310), realized by the unstake
+   t.unstake(bob, token_tester::peos(200'0000));
+   require_equal(t.balance(bob) - bob_before, token_tester::peos(53'3333), "bob's dividends");
+   require(reconciles(t), "ledger doesn't reconcile after unstaking");
+}
+
+// --- contract payouts ---
+
+TOKEN_TEST(issuer_payout_leaves_a_new_row_unclaimed)
+{
+   token_tester t;
+   const name carol = "carol"_n;
+   t.create_accounts({alice, carol});
+   t.fund(alice, token_tester::peos(10'0000));
+
+   // the contract is PEOS' issuer, so a UTXO paid out to a new account is an issuer-paid row
+   const auto key = private_key::from_seed("payout");
+   const auto id = t.next_utxo_id();
+   t.loadutxo(alice, key.get_public_key(), token_tester::peos(5'0000));
+   const std::vector<token::output> outputs = {{{}, carol, token_tester::peos(5'0000)}};
+   t.transferutxo(alice, {{id, key.sign(token_tester::utxo_digest(id, outputs))}}, outputs);
+   require_equal(t.balance(carol), token_tester::peos(5'0000), "carol's balance");
+
+   t.recover(carol);
+   require_equal(t.balance(carol), token_tester::peos(0), "carol's balance after recover");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   const std::vector<std::string> selected(argv + 1, argv + argc);
+
+   int failed = 0;
+   int ran = 0;
+   for (const auto &test : test_cases())
+   {
+      if (!selected.empty() && std::find(selected.begin(), selected.end(), test.name) == selected.end())
+      {
+         continue;
+      }
+      ++ran;
+      try
+      {
+         test.run();
+      }
+      catch (const std::exception &e)
+      {
+         ++failed;
+         fprintf(stderr, "FAIL %s: %s\n", test.name, e.what());
+         continue;
+      }
+      printf("ok   %s\n", test.name);
+   }
+   printf("%d of %d tests passed\n", ran - failed, ran);
+   return failed ? 1 : 0;
+}
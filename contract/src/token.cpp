@@ -5,6 +5,9 @@
 
 #include <token.hpp>
 
+#include <algorithm>
+#include <alloca.h>
+
 namespace eosio
 {
 
@@ -89,7 +92,70 @@ void token::issue(name to, asset quantity, string memo)
                          {st.issuer, to, quantity, memo});
    }
 
-   validate_peos_team_vesting(to, quantity);
+   validate_vesting(to, quantity);
+}
+
+void token::issuemany(const std::vector<recipient> &recipients, string memo)
+{
+   check(!recipients.empty(), "no recipients given");
+   check(memo.size() <= 256, "memo has more than 256 bytes");
+
+   auto sym = recipients.front().quantity.symbol;
+   check(sym.is_valid(), "invalid symbol name");
+
+   stats statstable(_self, sym.code().raw());
+   auto existing = statstable.find(sym.code().raw());
+   check(existing != statstable.end(), "token with symbol does not exist, create token before issue");
+   const auto &st = *existing;
+
+   require_auth(st.issuer);
+
+   // one entry per distinct account, so balances and vesting are touched once each
+   std::vector<recipient> merged(recipients);
+   std::sort(merged.begin(), merged.end(), [](const auto &a, const auto &b) { return a.to < b.to; });
+
+   asset total = asset(0, sym);
+   auto last = merged.begin();
+   for (auto r = merged.begin(); r != merged.end(); ++r)
+   {
+      check(r->quantity.is_valid(), "invalid quantity");
+      check(r->quantity.amount > 0, "must issue positive quantity");
+      check(r->quantity.symbol == st.supply.symbol, "symbol precision mismatch");
+      total += r->quantity;
+
+      if (r != merged.begin() && r->to == last->to)
+      {
+         last->quantity += r->quantity;
+      }
+      else if (r != merged.begin())
+      {
+         *++last = *r;
+      }
+   }
+   merged.erase(last + 1, merged.end());
+
+   check(total.amount <= st.max_supply.amount - st.supply.amount, "quantity exceeds available supply");
+
+   statstable.modify(st, same_payer, [&](auto &s) {
+      s.supply += total;
+   });
+
+   for (const auto &r : merged)
+   {
+      if (r.to == st.issuer)
+      {
+         add_balance(st.issuer, r.quantity, st.issuer, true);
+      }
+      else
+      {
+         // what issue's inline transfer from the issuer would leave behind
+         check(is_account(r.to), "to account does not exist");
+         add_balance(r.to, r.quantity, st.issuer, false);
+         SEND_INLINE_ACTION(*this, receipt, {{_self, "active"_n}}, {st.issuer, r.to, r.quantity, memo});
+      }
+
+      validate_vesting(r.to, r.quantity);
+   }
 }
 
 void token::retire(asset quantity, string memo)
@@ -148,6 +214,50 @@ void token::transfer(name from,
    }
 }
 
+void token::transfermany(name from,
+                         const std::vector<recipient> &recipients,
+                         string memo)
+{
+   require_auth(from);
+   check(!recipients.empty(), "no recipients given");
+   check(memo.size() <= 256, "memo has more than 256 bytes");
+
+   auto sym = recipients.front().quantity.symbol;
+   check(sym.is_valid(), "invalid symbol name");
+   stats statstable(_self, sym.code().raw());
+   const auto &st = statstable.get(sym.code().raw());
+   check(sym == st.supply.symbol, "symbol precision mismatch");
+
+   asset total = asset(0, sym);
+   for (const auto &r : recipients)
+   {
+      check(from != r.to, "cannot transfer to self");
+      check(is_account(r.to), "to account does not exist");
+      check(r.quantity.is_valid(), "invalid quantity");
+      check(r.quantity.amount > 0, "must transfer positive quantity");
+      check(r.quantity.symbol == sym, "symbol precision mismatch");
+      total += r.quantity;
+   }
+
+   require_recipient(from);
+
+   do_claim(from, sym.code(), from);
+   sub_balance(from, total);
+
+   for (const auto &r : recipients)
+   {
+      require_recipient(r.to);
+
+      auto payer = has_auth(r.to) ? r.to : from;
+      add_balance(r.to, r.quantity, payer, payer != st.issuer);
+
+      if (from != st.issuer)
+      {
+         do_claim(r.to, sym.code(), from);
+      }
+   }
+}
+
 void token::claim(name owner, symbol_code sym)
 {
    do_claim(owner, sym, owner);
@@ -159,23 +269,115 @@ void token::do_claim(name owner, symbol_code sym, name payer)
 
    check(sym.is_valid(), "Invalid symbol name");
 
-   accounts acnts(_self, owner.value);
+   bool found = with_account(_self, owner, sym, [&](auto &acnts, auto owner_acc) {
+      if (!isAccountClaimed(*owner_acc))
+      {
+         // modify() with a new payer moves the RAM in a single write
+         acnts.modify(owner_acc, payer, [&](auto &a) {
+            setAccount(a, getAccountBalance(a), true);
+         });
+      }
+   });
+   check(found, "no balance object found");
+}
+
+#pragma pack(push,1)
+struct drop_leaf {
+   uint64_t owner;
+   int64_t amount;
+   uint64_t symbol;
+};
+#pragma pack(pop)
+
+checksum256 token::getDropLeafHash(name owner, const asset &quantity)
+{
+   drop_leaf leaf = {owner.value, quantity.amount, quantity.symbol.raw()};
+   return sha256((const char *)&leaf, sizeof(drop_leaf));
+}
+
+checksum256 token::getDropNodeHash(const checksum256 &a, const checksum256 &b)
+{
+   auto left = a.extract_as_byte_array();
+   auto right = b.extract_as_byte_array();
+   if (right < left)
+   {
+      std::swap(left, right);
+   }
+
+   std::array<uint8_t, 64> node;
+   std::copy(left.begin(), left.end(), node.begin());
+   std::copy(right.begin(), right.end(), node.begin() + 32);
+   return sha256((const char *)node.data(), node.size());
+}
+
+void token::setdroproot(const symbol_code &sym, const checksum256 &root)
+{
+   check(sym.is_valid(), "invalid symbol name");
+
+   stats statstable(_self, sym.raw());
+   const auto &st = statstable.get(sym.raw(), "token with symbol does not exist");
+
+   require_auth(st.issuer);
+
+   drop_roots roots(_self, _self.value);
+   auto existing = roots.find(sym.raw());
+   if (existing == roots.end())
+   {
+      roots.emplace(st.issuer, [&](auto &r) {
+         r.sym = sym;
+         r.root = root;
+      });
+   }
+   else
+   {
+      roots.modify(existing, same_payer, [&](auto &r) {
+         r.root = root;
+      });
+   }
+}
+
+void token::claimdrop(name owner, asset quantity, const std::vector<checksum256> &proof)
+{
+   require_auth(owner);
 
-   const auto &owner_acc = acnts.get(sym.raw(), "no balance object found");
+   auto sym = quantity.symbol;
+   check(sym.is_valid(), "invalid symbol name");
+   check(quantity.is_valid(), "invalid quantity");
+   check(quantity.amount > 0, "must claim positive quantity");
+   check(proof.size() <= 64, "proof is too long");
+
+   stats statstable(_self, sym.code().raw());
+   const auto &st = statstable.get(sym.code().raw(), "token with symbol does not exist");
+   check(quantity.symbol == st.supply.symbol, "symbol precision mismatch");
 
-   if (!owner_acc.claimed)
+   drop_roots roots(_self, _self.value);
+   const auto &drop = roots.get(sym.code().raw(), "no airdrop published for symbol");
+
+   drop_claims claims(_self, sym.code().raw());
+   check(claims.find(owner.value) == claims.end(), "airdrop already claimed");
+
+   checksum256 node = getDropLeafHash(owner, quantity);
+   for (const auto &sibling : proof)
    {
-      auto balance = owner_acc.balance;
+      node = getDropNodeHash(node, sibling);
+   }
+   check(node == drop.root, "invalid airdrop proof");
 
-      acnts.erase(owner_acc);
+   claims.emplace(owner, [&](auto &c) {
+      c.owner = owner;
+   });
 
-      auto replace = acnts.find(sym.raw());
-      check(replace == acnts.end(), "There must be no balance object");
+   sub_balance(st.issuer, quantity);
 
-      acnts.emplace(payer, [&](auto &a) {
-         a.balance = balance;
-         a.claimed = true;
+   // claim an existing issuer-paid row along with the drop, or recover could take it back
+   bool found = with_account(_self, owner, sym.code(), [&](auto &acnts, auto owner_acc) {
+      acnts.modify(owner_acc, isAccountClaimed(*owner_acc) ? same_payer : owner, [&](auto &a) {
+         setAccount(a, getAccountBalance(a) + quantity, true);
       });
+   });
+   if (!found)
+   {
+      emplace_account(owner, quantity, true, owner);
    }
 }
 
@@ -190,45 +392,170 @@ void token::recover(name owner, symbol_code sym)
 
    require_auth(st.issuer);
 
-   accounts acnts(_self, owner.value);
+   asset recovered = asset(0, st.supply.symbol);
+   with_account(_self, owner, sym, [&](auto &acnts, auto owner_acc) {
+      if (!isAccountClaimed(*owner_acc)) {
+         recovered = getAccountBalance(*owner_acc);
+         acnts.erase(owner_acc);
+      }
+   });
 
-   const auto owner_acc = acnts.find(sym.raw());
-   if(owner_acc != acnts.end() && !owner_acc->claimed) {      
-      add_balance(st.issuer, owner_acc->balance, st.issuer, true);
-      acnts.erase(owner_acc);
+   if (recovered.amount > 0)
+   {
+      add_balance(st.issuer, recovered, st.issuer, true);
    }
 }
 
-void token::sub_balance(name owner, asset value)
+void token::recovermany(const std::vector<name> &owners, symbol_code sym)
 {
-   accounts from_acnts(_self, owner.value);
+   check(sym.is_valid(), "invalid symbol name");
+   check(!owners.empty(), "no owners given");
+
+   stats statstable(_self, sym.raw());
+   auto existing = statstable.find(sym.raw());
+   check(existing != statstable.end(), "token with symbol does not exist");
+   const auto &st = *existing;
+
+   require_auth(st.issuer);
+
+   asset total = asset(0, st.supply.symbol);
+   for (auto owner : owners)
+   {
+      with_account(_self, owner, sym, [&](auto &acnts, auto owner_acc) {
+         if (!isAccountClaimed(*owner_acc)) {
+            total += getAccountBalance(*owner_acc);
+            acnts.erase(owner_acc);
+         }
+      });
+   }
 
-   const auto &from = from_acnts.get(value.symbol.code().raw(), "no balance object found");
-   check(from.balance.amount >= value.amount, "overdrawn balance");
+   if (total.amount > 0)
+   {
+      add_balance(st.issuer, total, st.issuer, true);
+   }
+}
 
-   from_acnts.modify(from, owner, [&](auto &a) {
-      a.balance -= value;
-      a.claimed = true;
+void token::sub_balance(name owner, asset value)
+{
+   bool found = with_account(_self, owner, value.symbol.code(), [&](auto &from_acnts, auto from) {
+      check(getAccountBalance(*from).amount >= value.amount, "overdrawn balance");
+
+      from_acnts.modify(from, owner, [&](auto &a) {
+         setAccount(a, getAccountBalance(a) - value, true);
+      });
    });
+   check(found, "no balance object found");
 }
 
 void token::add_balance(name owner, asset value, name ram_payer, bool claimed)
 {
-   accounts to_acnts(_self, owner.value);
-   auto to = to_acnts.find(value.symbol.code().raw());
-   if (to == to_acnts.end())
+   if (!credit_balance(owner, value))
    {
-      to_acnts.emplace(ram_payer, [&](auto &a) {
-         a.balance = value;
-         a.claimed = claimed;
+      emplace_account(owner, value, claimed, ram_payer);
+   }
+}
+
+bool token::credit_balance(name owner, asset value)
+{
+   return with_account(_self, owner, value.symbol.code(), [&](auto &to_acnts, auto to) {
+      to_acnts.modify(to, same_payer, [&](auto &a) {
+         setAccount(a, getAccountBalance(a) + value, isAccountClaimed(a));
       });
+   });
+}
+
+void token::emplace_account(name owner, const asset &balance, bool claimed, name ram_payer)
+{
+#ifdef TOKEN_COMPACT_ACCOUNTS
+   if (balance.symbol.code() == PEOS_SYMBOL.code())
+   {
+      compact_accounts compact(_self, owner.value);
+      compact.emplace(ram_payer, [&](auto &a) {
+         setAccount(a, balance, claimed);
+      });
+      return;
    }
-   else
+#endif
+   accounts acnts(_self, owner.value);
+   acnts.emplace(ram_payer, [&](auto &a) {
+      setAccount(a, balance, claimed);
+   });
+}
+
+void token::migrateaccts(const std::vector<name> &owners)
+{
+   require_auth(_self);
+#ifndef TOKEN_COMPACT_ACCOUNTS
+   check(false, "compact balances are disabled in this build");
+#endif
+   check(!owners.empty() && owners.size() <= 500, "migrate between 1 and 500 owners");
+
+   const auto sym = PEOS_SYMBOL.code().raw();
+   for (auto owner : owners)
    {
-      to_acnts.modify(to, same_payer, [&](auto &a) {
-         a.balance += value;
+      accounts acnts(_self, owner.value);
+      auto legacy = acnts.find(sym);
+      if (legacy == acnts.end())
+      {
+         continue;
+      }
+
+      compact_accounts compact(_self, owner.value);
+      compact.emplace(_self, [&](auto &a) {
+         setAccount(a, legacy->balance, legacy->claimed);
       });
+      acnts.erase(legacy);
+   }
+}
+
+void token::pendingdiv(name owner)
+{
+   print(get_pending_dividends(_self, owner));
+}
+
+void token::getaccounts(const std::vector<name> &owners)
+{
+   check(!owners.empty(), "no owners given");
+   check(owners.size() <= 1000, "at most 1000 owners per query");
+
+   print("[");
+   for (size_t i = 0; i < owners.size(); ++i)
+   {
+      auto state = get_account_state(_self, owners[i]);
+      print(i ? "," : "", "{\"owner\":\"", state.owner,
+            "\",\"balance\":\"", state.balance,
+            "\",\"claimed\":", state.claimed,
+            ",\"staked\":\"", state.staked,
+            "\",\"pending_dividends\":\"", state.pending_dividends,
+            "\",\"refunding\":\"", state.refunding,
+            "\",\"refund_request_time\":", state.refund_request_time, "}");
+   }
+   print("]");
+}
+
+void token::move_balance(name from, name to, asset quantity, const string &memo)
+{
+   // the ledger effect of an inline transfer from the contract's own flows,
+   // without its dispatch, claims and notifications; stats is only read for a new row
+   check(from != to, "cannot transfer to self");
+
+   sub_balance(from, quantity);
+   if (!credit_balance(to, quantity))
+   {
+      // a new row is claimed unless the issuer pays for it, as with transfer
+      stats statstable(_self, quantity.symbol.code().raw());
+      const auto &st = statstable.get(quantity.symbol.code().raw(), "token with symbol does not exist");
+      emplace_account(to, quantity, from != st.issuer, from);
    }
+
+   SEND_INLINE_ACTION(*this, receipt, {{_self, "active"_n}}, {from, to, quantity, memo});
+}
+
+void token::receipt(name from, name to, asset, string)
+{
+   require_auth(_self);
+   require_recipient(from);
+   require_recipient(to);
 }
 
 void token::open(name owner, const symbol &symbol, name ram_payer)
@@ -241,77 +568,116 @@ void token::open(name owner, const symbol &symbol, name ram_payer)
    const auto &st = statstable.get(sym_code_raw, "symbol does not exist");
    check(st.supply.symbol == symbol, "symbol precision mismatch");
 
-   accounts acnts(_self, owner.value);
-   auto it = acnts.find(sym_code_raw);
-   if (it == acnts.end())
+   if (!with_account(_self, owner, symbol.code(), [](auto &, auto) {}))
    {
-      acnts.emplace(ram_payer, [&](auto &a) {
-         a.balance = asset{0, symbol};
-         a.claimed = true;
-      });
+      emplace_account(owner, asset{0, symbol}, true, ram_payer);
    }
 }
 
 void token::close(name owner, const symbol &symbol)
 {
    require_auth(owner);
-   accounts acnts(_self, owner.value);
-   auto it = acnts.find(symbol.code().raw());
-   check(it != acnts.end(), "Balance row already deleted or never existed. Action won't have any effect.");
-   check(it->balance.amount == 0, "Cannot close because the balance is not zero.");
-   acnts.erase(it);
+   bool found = with_account(_self, owner, symbol.code(), [&](auto &acnts, auto it) {
+      check(getAccountBalance(*it).amount == 0, "Cannot close because the balance is not zero.");
+      acnts.erase(it);
+   });
+   check(found, "Balance row already deleted or never existed. Action won't have any effect.");
 }
 
-void token::validate_peos_team_vesting(name account, asset quantity)
+int64_t token::vesting_schedule::vested(uint32_t time) const
 {
-   vesting vest_accounts(_self, _self.value);
-   auto vest = vest_accounts.find(account.value);
-   int64_t claimed = 0;
+   if (time < (uint64_t)start + cliff)
+   {
+      return 0;
+   }
 
-   if (  
-      account == PEOS_MARKETING_ACCOUNT ||
-      account == PEOS_TEAMFUND_ACCOUNT ||
-      account == PEOS_CONTRACT_ACCOUNT
-      )
+   uint64_t elapsed = time - start;
+   if (duration == 0 || elapsed >= duration)
    {
-      if (vest != vest_accounts.end())
-      {
-         claimed = vest->issued.amount;
+      return total.amount;
+   }
+   if (step > 0)
+   {
+      elapsed -= elapsed % step;
+   }
+   return (int64_t)((int128_t)total.amount * elapsed / duration);
+}
 
-         vest_accounts.modify(vest, _self, [&](auto &v) {
-            v.issued += quantity;
-         });
-      }
-      else
-      {
-         vest_accounts.emplace(_self, [&](auto &v) {
-            v.account = account;
-            v.issued = quantity;
-         });
-      }
-   } 
+void token::setvesting(name account, asset total, uint32_t start, uint32_t cliff, uint32_t duration, uint32_t step)
+{
+   require_auth(_self);
 
-   if ( account == PEOS_MARKETING_ACCOUNT ) 
+   check(is_account(account), "account does not exist");
+   check(total.is_valid(), "invalid quantity");
+   check(total.amount >= 0, "total must not be negative");
+   check(step <= duration, "step longer than the vesting duration");
+
+   vesting_schedules schedules(_self, _self.value);
+   auto sched = schedules.find(account.value);
+   if (sched != schedules.end())
    {
-      const int64_t claimable = 50'000'000'0000ll;
-      check(claimable >= claimed + quantity.amount, "pEOS marketing/operations budget claimed");
+      check(total.symbol == sched->total.symbol, "symbol precision mismatch");
+
+      schedules.modify(sched, same_payer, [&](auto &v) {
+         v.total = total;
+         v.start = start;
+         v.cliff = cliff;
+         v.duration = duration;
+         v.step = step;
+      });
+      return;
    }
-   else if ( account == PEOS_TEAMFUND_ACCOUNT )
-   {
-      const int64_t base_time = 1551096000; // 2019-02-25
-      const int64_t max_claimable = 200'000'000'0000ll;
-      const int64_t claimable = int64_t(max_claimable * double(now() - base_time) / (400 * seconds_per_day));
-      check(claimable >= claimed + quantity.amount, "pEOS team can only issue their tokens over 400 days");
-   } 
-   else if ( account == PEOS_CONTRACT_ACCOUNT ) 
-   { 
-      const int64_t claimable = 596'224'1696ll;
-      check(claimable >= claimed + quantity.amount, "pEOS token budget for <1.0000 PEOS airdrop accounts and contracts claimed");
-   } 
-   else
+
+   // carry over what was issued under the former hard-coded budgets
+   asset issued = asset(0, total.symbol);
+   vesting vest_accounts(_self, _self.value);
+   auto legacy = vest_accounts.find(account.value);
+   if (legacy != vest_accounts.end())
    {
-      check(false, "token issuing era finished");
+      check(legacy->issued.symbol == total.symbol, "symbol precision mismatch");
+      issued = legacy->issued;
+      vest_accounts.erase(legacy);
    }
+
+   schedules.emplace(_self, [&](auto &v) {
+      v.account = account;
+      v.total = total;
+      v.issued = issued;
+      v.start = start;
+      v.cliff = cliff;
+      v.duration = duration;
+      v.step = step;
+   });
+}
+
+void token::delvesting(name account)
+{
+   require_auth(_self);
+
+   vesting_schedules schedules(_self, _self.value);
+   const auto &sched = schedules.get(account.value, "no vesting schedule for account");
+   check(sched.total.amount > 0, "vesting schedule already removed");
+
+   schedules.modify(sched, same_payer, [&](auto &v) {
+      v.total.amount = 0;
+      v.start = 0;
+      v.cliff = 0;
+      v.duration = 0;
+      v.step = 0;
+   });
+}
+
+void token::validate_vesting(name account, asset quantity)
+{
+   vesting_schedules schedules(_self, _self.value);
+   auto sched = schedules.find(account.value);
+   check(sched != schedules.end(), "token issuing era finished");
+   check(sched->vested(now()) - sched->issued.amount >= quantity.amount,
+         "issuance exceeds vested budget of " + account.to_string());
+
+   schedules.modify(sched, same_payer, [&](auto &v) {
+      v.issued += quantity;
+   });
 }
 
 #pragma pack(push,1)
@@ -321,6 +687,32 @@ struct sign_data {
 };
 #pragma pack(pop)
 
+// serializes straight into an exactly sized buffer, on the stack unless large
+// (same threshold as eosiolib's unpack_action_data), and hashes it
+template <typename... Ts>
+static checksum256 sha256Packed(const Ts &... values)
+{
+   constexpr size_t max_stack_buffer_size = 512;
+   const size_t size = (pack_size(values) + ...);
+   const bool heap = max_stack_buffer_size < size;
+   char *buffer = (char *)(heap ? malloc(size) : alloca(size));
+
+   datastream<char *> ds(buffer, size);
+   (ds << ... << values);
+   checksum256 digest = sha256(buffer, size);
+
+   if (heap)
+   {
+      free(buffer);
+   }
+   return digest;
+}
+
+checksum256 token::getOutputsDigest(const std::vector<output> &outputs)
+{
+   return sha256Packed(outputs);
+}
+
 void token::transferutxo(const name &payer, const std::vector<input> &inputs, const std::vector<output> &outputs, const string &memo) 
 {
    utxos utxostable(_self, _self.value);
@@ -328,8 +720,7 @@ void token::transferutxo(const name &payer, const std::vector<input> &inputs, co
 
    check(memo.size() <= 256, "memo has more than 256 bytes");
 
-   auto p = pack(outputs);
-   checksum256 outputsDigest = sha256(&p[0], p.size());
+   checksum256 outputsDigest = getOutputsDigest(outputs);
 
    asset inputSum = asset(0, PEOS_SYMBOL);
    for(auto in = inputs.cbegin() ; in != inputs.cend() ; ++in) {
@@ -344,6 +735,80 @@ void token::transferutxo(const name &payer, const std::vector<input> &inputs, co
       utxostable.erase(utxo);
    }
 
+   payUTXOOutputs(utxostable, payer, inputSum, outputs, memo);
+}
+
+void token::transferkeys(const name &payer, const std::vector<keyinput> &inputs, const std::vector<output> &outputs, const string &memo) 
+{
+   utxos utxostable(_self, _self.value);
+   require_auth(payer);
+
+   check(memo.size() <= 256, "memo has more than 256 bytes");
+
+   checksum256 outputsDigest = getOutputsDigest(outputs);
+
+   asset inputSum = asset(0, PEOS_SYMBOL);
+   for(auto in = inputs.cbegin() ; in != inputs.cend() ; ++in) {
+      check(!in->ids.empty(), "Key input without UTXOs");
+
+      // the spent ids are erased below and never reissued, so the signature can't be replayed
+      checksum256 digest = sha256Packed(in->ids, outputsDigest);
+      assert_recover_key(digest, in->sig, in->pk);
+
+      for(auto id : in->ids) {
+         auto utxo = utxostable.find(id);
+         check(utxo != utxostable.end(), "Unknown UTXO");
+         check(utxo->pk == in->pk, "UTXO not owned by key");
+         inputSum += utxo->amount;
+
+         utxostable.erase(utxo);
+      }
+   }
+
+   payUTXOOutputs(utxostable, payer, inputSum, outputs, memo);
+}
+
+void token::sweeputxo(const name &payer, const public_key &pk, uint32_t max, const signature &sig) 
+{
+   utxos utxostable(_self, _self.value);
+   require_auth(payer);
+
+   check(max >= 2 && max <= 500, "Sweep between 2 and 500 UTXOs");
+
+   auto byPk = utxostable.get_index<"ipk"_n>();
+   const auto keyHash = getKeyHash(pk);
+   auto utxo = byPk.lower_bound(keyHash);
+   check(utxo != byPk.end() && utxo->by_pk() == keyHash, "No UTXOs for key");
+
+   // the first swept id is erased and never reissued, so the signature can't be replayed
+   checksum256 digest = sha256Packed(utxo->id, max);
+   assert_recover_key(digest, sig, pk);
+
+   asset sum = asset(0, PEOS_SYMBOL);
+   uint32_t count = 0;
+   while (utxo != byPk.end() && count < max && utxo->by_pk() == keyHash) {
+      check(utxo->pk == pk, "UTXO key hash collision");
+      sum += utxo->amount;
+      utxo = byPk.erase(utxo);
+      ++count;
+   }
+   check(count >= 2, "Nothing to consolidate");
+
+   utxostable.emplace(payer, [&](auto &u){
+      u.id = reserveUTXOIds(1);
+      u.pk = pk;
+      u.amount = sum;
+   });
+}
+
+void token::payUTXOOutputs(utxos &utxostable, const name &payer, const asset &inputSum, const std::vector<output> &outputs, const string &memo)
+{
+   uint64_t utxoCount = 0;
+   for(const auto &o : outputs) {
+      if (o.account.value == 0) ++utxoCount;
+   }
+   uint64_t nextId = utxoCount > 0 ? reserveUTXOIds(utxoCount) : 0;
+
    asset outputSum = asset(0, PEOS_SYMBOL);
    for(auto oIter = outputs.cbegin() ; oIter != outputs.cend() ; ++oIter) {
       auto q = oIter->quantity;
@@ -354,12 +819,13 @@ void token::transferutxo(const name &payer, const std::vector<input> &inputs, co
 
       if (oIter->account.value != 0) 
       {  
-         SEND_INLINE_ACTION(*this, transfer, {{_self, "active"_n}}, {_self, oIter->account, q, memo});
+         check(is_account(oIter->account), "to account does not exist");
+         move_balance(_self, oIter->account, q, memo);
       } 
       else 
       {
          utxostable.emplace(payer, [&](auto &u){
-            u.id = getNextUTXOId();
+            u.id = nextId++;
             u.pk = oIter->pk;
             u.amount = q;
          });
@@ -371,7 +837,7 @@ void token::transferutxo(const name &payer, const std::vector<input> &inputs, co
    asset fees = inputSum - outputSum;
    if (fees.amount > 0) 
    {  
-      SEND_INLINE_ACTION(*this, transfer, {{_self, "active"_n}}, {_self, payer, fees, ""});
+      move_balance(_self, payer, fees, "");
    }
 }
 
@@ -388,18 +854,20 @@ void token::loadutxo(const name &from, const public_key &pk, const asset &quanti
    check(existing != statstable.end(), "token with symbol does not exist");
    const auto &st = *existing;
 
-   SEND_INLINE_ACTION(*this, transfer, {{from, "active"_n}}, {from, st.issuer, quantity, ""});
+   check(quantity.is_valid(), "invalid quantity");
+   check(quantity.symbol == st.supply.symbol, "symbol precision mismatch");
+   move_balance(from, st.issuer, quantity, "");
 
    utxos utxostable(_self, _self.value);
 
    utxostable.emplace(from, [&](auto &u){
-      u.id = getNextUTXOId();
+      u.id = reserveUTXOIds(1);
       u.pk = pk;
       u.amount = quantity;
    });
 }
 
-uint64_t token::getNextUTXOId() 
+uint64_t token::reserveUTXOIds(uint64_t count) 
 {
    utxo_globals globals(_self, _self.value);
 
@@ -409,20 +877,87 @@ uint64_t token::getNextUTXOId()
    if (it == globals.end()) 
    {
       globals.emplace(_self, [&](auto &g){
-         g.next_pk = 1;
+         g.id = 0;
+         g.next_pk = count;
       });
    }
    else 
    {
       globals.modify(it, same_payer, [&](auto &g){
          ret = g.next_pk;
-         g.next_pk += 1;
+         g.next_pk += count;
       });
    }
 
    return ret;
 }
 
+token::dividends::const_iterator token::migrate_dividend(dividends &dividend)
+{
+   legacy_dividends legacy(_self, _self.value);
+   auto old = legacy.find(PEOS_SYMBOL.code().raw());
+   if (old == legacy.end())
+   {
+      return dividend.end();
+   }
+
+   auto converted = dividend.emplace(_self, [&](auto &d) {
+      d = getDividend(*old);
+   });
+   legacy.erase(old);
+   return converted;
+}
+
+void token::migratestake(const std::vector<name> &owners)
+{
+   require_auth(_self);
+   check(owners.size() <= 500, "migrate at most 500 owners");
+
+   const auto sym = PEOS_SYMBOL.code().raw();
+   dividends dividend(_self, _self.value);
+   auto div = dividend.find(sym);
+   if (div == dividend.end())
+   {
+      div = migrate_dividend(dividend);
+   }
+
+   for (auto owner : owners)
+   {
+      legacy_stakes legacy(_self, owner.value);
+      auto old = legacy.find(sym);
+      if (old == legacy.end())
+      {
+         continue;
+      }
+      check(div != dividend.end(), "legacy stake without a dividend row");
+
+      const auto converted = getStake(*old);
+      legacy.erase(old);
+
+      staked owner_staked(_self, owner.value);
+      auto stake = owner_staked.find(sym);
+      if (stake == owner_staked.end())
+      {
+         owner_staked.emplace(_self, [&](auto &s) {
+            s = converted;
+         });
+         continue;
+      }
+
+      // staked again before this ran: pay out both parts' dividends and merge them
+      int64_t profit = getDividendShare(*div, converted) + getDividendShare(*div, *stake);
+      add_dividend_shard(owner, 0, profit);
+      owner_staked.modify(stake, same_payer, [&](auto &s) {
+         s.quantity += converted.quantity;
+         s.lastDividendsPerShare = div->dividendsPerShare;
+      });
+      if (profit > 0)
+      {
+         move_balance(_self, owner, asset{profit, PEOS_SYMBOL}, "Your dividents from staked PEOS tokens");
+      }
+   }
+}
+
 void token::realizediv(const name &owner)
 {
    require_auth(owner);
@@ -444,31 +979,22 @@ void token::realizediv(const name &owner)
 
    dividends dividend(_self, _self.value);
 
-   double totalDividendFrac = 1.0;
    auto div = dividend.find(sym);
-   if (div != dividend.end())
+   if (div == dividend.end() || div->dividendsPerShare == stake->lastDividendsPerShare)
    {
-      totalDividendFrac = div->totalDividendFrac;
+      return;
    }
 
-   double profit = (div->totalDividendFrac - stake->lastDividendsFrac);
-   profit *= stake->quantity.amount;
+   int64_t profit = getDividendShare(*div, *stake);
 
-   dividend.modify(div, _self, [&](auto &d) {
-      d.totalUnclaimedDividends.amount -= profit;
-   });
+   add_dividend_shard(owner, 0, profit);
 
    owner_staked.modify(stake, owner, [&](auto &s) {
-      s.lastDividendsFrac = div->totalDividendFrac;
+      s.lastDividendsPerShare = div->dividendsPerShare;
    });
 
-   if(profit >= 1.0) {
-      SEND_INLINE_ACTION(
-         *this, 
-         transfer, 
-         {get_self(), "active"_n}, 
-         {get_self(), owner, asset{(int64_t)profit, PEOS_SYMBOL}, std::string("Your dividents from staked PEOS tokens")}
-      );
+   if(profit > 0) {
+      move_balance(get_self(), owner, asset{profit, PEOS_SYMBOL}, "Your dividents from staked PEOS tokens");
    }
 }
 
@@ -490,42 +1016,45 @@ void token::stake(const name &owner, asset quantity)
    const auto &stake = owner_staked.find(sym);
    dividends dividend(_self, _self.value);
 
-   double totalDividendFrac = 1.0;
+   uint128_t dividendsPerShare = 0;
    auto div = dividend.find(sym);
+   if (div == dividend.end())
+   {
+      div = migrate_dividend(dividend);
+   }
    if(div != dividend.end()) 
    {
-      totalDividendFrac = div->totalDividendFrac;
-
-      dividend.modify(div, _self, [&](auto &d) {
-         d.totalStaked += quantity;
-      });
+      dividendsPerShare = div->dividendsPerShare;
    }
    else 
    {
       dividend.emplace(_self, [&](auto &s) {
-         s.totalStaked = quantity;
+         s.totalStaked = asset{0, PEOS_SYMBOL};
          s.totalDividends = asset{0, PEOS_SYMBOL};
          s.totalUnclaimedDividends = asset{0, PEOS_SYMBOL};
 
-         s.totalDividendFrac = 1.0;
+         s.dividendsPerShare = 0;
+         s.dividendsRemainder = 0;
       });
    }
 
+   add_dividend_shard(owner, quantity.amount, 0);
+
    if(stake != owner_staked.end()) {
       owner_staked.modify(stake, owner, [&](auto &s) {
          s.quantity += quantity;
-         check(s.lastDividendsFrac == totalDividendFrac, "Divs not realized");
+         check(s.lastDividendsPerShare == dividendsPerShare, "Divs not realized");
       });
    }
    else
    {
       owner_staked.emplace(owner, [&](auto &s) {
          s.quantity = quantity;
-         s.lastDividendsFrac = totalDividendFrac;
+         s.lastDividendsPerShare = dividendsPerShare;
       });
    }
 
-   SEND_INLINE_ACTION(*this, transfer, {owner, "active"_n}, {owner, _self, quantity, "PEOS tokens staked"});
+   move_balance(owner, _self, quantity, "PEOS tokens staked");
 }
 
 void token::unstake(const name &owner, asset quantity)
@@ -558,23 +1087,39 @@ void token::unstake(const name &owner, asset quantity)
    check(quantity.amount > 0, "must unstake positive quantity");
    check(quantity.symbol == st.supply.symbol, "symbol precision mismatch");
 
-   dividends dividend(_self, _self.value);
-   auto div = dividend.find(sym);
+   add_dividend_shard(owner, -quantity.amount, 0);
 
-   dividend.modify(div, _self, [&](auto &d) {
-      d.totalStaked -= quantity;
-   });
+   refund_queue queue( get_self(), get_self().value );
 
+   // a request left in the former owner-scoped table becomes the oldest tranche
    refunds_table refunds_tbl( get_self(), owner.value );
-   auto req = refunds_tbl.find( owner.value );
+   auto legacy = refunds_tbl.find( owner.value );
+   if (legacy != refunds_tbl.end()) {
+      queue.emplace( owner, [&]( refund_entry& r ) {
+         r.id = queue.available_primary_key();
+         r.owner = owner;
+         r.request_time = legacy->request_time;
+         r.amount = legacy->amount;
+      });
+      refunds_tbl.erase( legacy );
+   }
+
+   auto byowner = queue.get_index<"byowner"_n>();
+   uint32_t tranches = 0;
+   auto newest = byowner.end();
+   for (auto tranche = byowner.lower_bound( owner.value ); tranche != byowner.end() && tranche->owner == owner; ++tranche) {
+      newest = tranche;
+      ++tranches;
+   }
 
-   if (req != refunds_tbl.end()) {
-      refunds_tbl.modify( req, owner, [&]( refund_request& r ) {
+   if (newest != byowner.end() && (newest->request_time == now() || tranches >= MAX_REFUND_TRANCHES)) {
+      byowner.modify( newest, owner, [&]( refund_entry& r ) {
          r.request_time = now();
          r.amount += quantity;
-      }); 
+      });
    } else {
-      refunds_tbl.emplace( owner, [&]( refund_request& r ) {
+      queue.emplace( owner, [&]( refund_entry& r ) {
+         r.id = queue.available_primary_key();
          r.owner = owner;
          r.request_time = now();
          r.amount = quantity;
@@ -585,19 +1130,51 @@ void token::unstake(const name &owner, asset quantity)
 void token::refund(const name &owner) {
    require_auth( owner );
 
+   asset matured( 0, PEOS_SYMBOL );
+
    refunds_table refunds_tbl( get_self(), owner.value );
    auto req = refunds_tbl.find( owner.value );
-   check( req != refunds_tbl.end(), "refund request not found" );
-   check( req->request_time + refund_delay <= now(), "refund is not available yet" );
-
-   SEND_INLINE_ACTION(
-      *this, 
-      transfer, 
-      {get_self(), "active"_n}, 
-      {get_self(), owner, req->amount, std::string("Your unstaked PEOS tokens")}
-   );
-   
-   refunds_tbl.erase( req );
+   bool pending = req != refunds_tbl.end();
+   if (pending && req->request_time + refund_delay <= now()) {
+      matured += req->amount;
+      refunds_tbl.erase( req );
+   }
+
+   refund_queue queue( get_self(), get_self().value );
+   auto byowner = queue.get_index<"byowner"_n>();
+   auto tranche = byowner.lower_bound( owner.value );
+   for (; tranche != byowner.end() && tranche->owner == owner; ) {
+      pending = true;
+      if (tranche->request_time + refund_delay > now()) {
+         break;
+      }
+      matured += tranche->amount;
+      tranche = byowner.erase( tranche );
+   }
+
+   check( pending, "refund request not found" );
+   check( matured.amount > 0, "refund is not available yet" );
+
+   move_balance(get_self(), owner, matured, "Your unstaked PEOS tokens");
+}
+
+void token::procrefunds(uint32_t max) {
+   check( max > 0 && max <= 500, "process between 1 and 500 refunds" );
+
+   refund_queue queue( get_self(), get_self().value );
+   auto bytime = queue.get_index<"bytime"_n>();
+
+   uint32_t count = 0;
+   for (auto req = bytime.begin(); req != bytime.end() && count < max; ++count) {
+      if (req->request_time + refund_delay > now()) {
+         break;
+      }
+
+      move_balance(get_self(), req->owner, req->amount, "Your unstaked PEOS tokens");
+      req = bytime.erase( req );
+   }
+
+   check( count > 0, "no matured refunds" );
 }
 
 void token::distribute(const name &owner, asset quantity)
@@ -606,38 +1183,78 @@ void token::distribute(const name &owner, asset quantity)
    
    const auto sym = PEOS_SYMBOL.code().raw();
 
-   SEND_INLINE_ACTION(*this, transfer, {owner, "active"_n}, {owner, _self, quantity, ""});
-
+   check(quantity.is_valid(), "invalid quantity");
    check(quantity.symbol == PEOS_SYMBOL, "Only distribute PEOS");
    check(quantity.amount > 0, "Can't distribute negative tokens");
 
+   move_balance(owner, _self, quantity, "");
+
    dividends dividend(_self, _self.value);
 
    auto div = dividend.find(sym);
    if (div == dividend.end())
+   {
+      div = migrate_dividend(dividend);
+   }
+   if (div == dividend.end())
    {
       dividend.emplace(_self, [&](auto &s) {
          s.totalStaked = asset{0, PEOS_SYMBOL};
          s.totalDividends = asset{0, PEOS_SYMBOL};
          s.totalUnclaimedDividends = quantity;
 
-         s.totalDividendFrac = 1.0;
+         s.dividendsPerShare = 0;
+         s.dividendsRemainder = 0;
       });
    }
    else
    {
+      int64_t totalStaked = div->totalStaked.amount;
+      dividend_shards shards(_self, _self.value);
+      for (const auto &shard : shards)
+      {
+         totalStaked += shard.staked.amount;
+      }
+
       dividend.modify(div, get_self(), [&](auto &s) {
          
          s.totalUnclaimedDividends += quantity;
-         if (s.totalStaked.amount > 0) 
+         if (totalStaked > 0) 
          {
                s.totalDividends += quantity;
-               s.totalDividendFrac += (double)quantity.amount / (double)s.totalStaked.amount;
+
+               // carry what the division drops into the next distribution
+               uint128_t scaled = ((uint128_t)quantity.amount << DIVIDEND_FRACTION_BITS) + s.dividendsRemainder;
+               s.dividendsPerShare += scaled / (uint64_t)totalStaked;
+               s.dividendsRemainder = (uint64_t)(scaled % (uint64_t)totalStaked);
          }            
       });
    }
 }
 
+void token::add_dividend_shard(name owner, int64_t staked, int64_t realized)
+{
+   dividend_shards shards(_self, _self.value);
+   const uint64_t id = getDividendShardId(owner);
+
+   auto shard = shards.find(id);
+   if (shard == shards.end())
+   {
+      shards.emplace(_self, [&](auto &s) {
+         s.id = id;
+         s.staked = asset{staked, PEOS_SYMBOL};
+         s.realized = asset{realized, PEOS_SYMBOL};
+      });
+   }
+   else
+   {
+      shards.modify(shard, same_payer, [&](auto &s) {
+         s.staked.amount += staked;
+         s.realized.amount += realized;
+      });
+   }
+}
+
 } // namespace eosio
 
-EOSIO_DISPATCH(eosio::token, (create)(update)(issue)(transfer)(claim)(recover)(retire)(close)(transferutxo)(loadutxo)(stake)(unstake)(realizediv)(refund)(distribute))
+EOSIO_DISPATCH(eosio::token, (create)(update)(issue)(issuemany)(transfer)(transfermany)(receipt)(claim)(setdroproot)(claimdrop)(recover)(recovermany)(retire)(setvesting)(delvesting)(close)(migrateaccts)(migratestake)(transferutxo)(transferkeys)(sweeputxo)(loadutxo)(pendingdiv)(getaccounts)(stake)(unstake)(realizediv)(refund)(procrefunds)(distribute))
@@ -0,0 +1,49 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Memory mapping of a whole file, so multi-gigabyte dumps are parsed in
+ *  place by several threads and output files are filled without copies.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace eosio
+{
+namespace tools
+{
+
+class mapped_file
+{
+ public:
+   /// Maps an existing file read-only. Throws std::runtime_error when it can't be opened or mapped.
+   explicit mapped_file(const std::string &path);
+
+   /// Creates, or truncates, a file of `size` bytes and maps it writable.
+   mapped_file(const std::string &path, size_t size);
+
+   ~mapped_file();
+
+   mapped_file(const mapped_file &) = delete;
+   mapped_file &operator=(const mapped_file &) = delete;
+
+   const char *data() const { return _data; }
+   char *data() { return _data; }
+   size_t size() const { return _size; }
+   std::string_view view() const { return {_data, _size}; }
+
+   /// Hints that the file is read front to back, so the kernel reads ahead.
+   void sequential();
+
+ private:
+   void map(int fd, const std::string &path, bool writable);
+
+   char *_data = nullptr;
+   size_t _size = 0;
+};
+
+} // namespace tools
+} // namespace eosio
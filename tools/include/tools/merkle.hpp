@@ -0,0 +1,105 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Merkle trees over airdrop allocations, hashed exactly like the contract's
+ *  claimdrop: a leaf is sha256 of the packed (owner, amount, symbol) row, an
+ *  inner node sha256 of its two children in ascending byte order, and an
+ *  unpaired node moves up a level unchanged.
+ *
+ *  The tree is written to a proof file that is used memory-mapped:
+ *
+ *      proof_header
+ *      proof_entry   buckets[bucket_count]   owner -> leaf, open addressing
+ *      proof_leaf    leaves[leaf_count]      sorted by owner
+ *      drop_hash     nodes[]                 level 0 (leaf hashes) up to the root
+ *
+ *  so finding an account is O(1) and its proof is one read per level.
+ */
+#pragma once
+
+#include <tools/mapped_file.hpp>
+#include <tools/snapshot.hpp>
+
+#include <eosiolib/symbol.hpp>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace eosio
+{
+namespace tools
+{
+
+using drop_hash = std::array<uint8_t, 32>;
+
+drop_hash drop_leaf_hash(name owner, int64_t amount, symbol sym);
+drop_hash drop_node_hash(const drop_hash &a, const drop_hash &b);
+
+std::string to_hex(const drop_hash &hash);
+
+struct proof_header
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t levels;
+   uint64_t leaf_count;
+   uint64_t bucket_count;
+   uint64_t symbol;
+   drop_hash root;
+};
+
+struct proof_entry
+{
+   uint64_t owner;
+   /// Leaf index + 1; 0 marks an empty bucket.
+   uint64_t leaf;
+};
+
+struct proof_leaf
+{
+   uint64_t owner;
+   int64_t amount;
+};
+
+struct drop_proof
+{
+   name owner;
+   int64_t amount = 0;
+   std::vector<drop_hash> siblings;
+};
+
+/// Builds the tree of `leaves` (sorted by owner, owners unique) into a new proof file and returns the root.
+drop_hash build_proof_file(const std::string &path, const std::vector<holder> &leaves, symbol sym, unsigned threads);
+
+class proof_file
+{
+ public:
+   /// Throws std::runtime_error when the file isn't a complete proof file.
+   explicit proof_file(const std::string &path);
+
+   const proof_header &header() const { return *_header; }
+   symbol sym() const { return symbol(_header->symbol); }
+
+   uint64_t leaf_count() const { return _header->leaf_count; }
+
+   std::optional<drop_proof> find(name owner) const;
+
+   /// Proof of the leaf at `leaf`, counted in owner order.
+   drop_proof proof(uint64_t leaf) const;
+
+ private:
+   mapped_file _file;
+   const proof_header *_header = nullptr;
+   const proof_entry *_buckets = nullptr;
+   const proof_leaf *_leaves = nullptr;
+   const drop_hash *_nodes = nullptr;
+   std::vector<uint64_t> _levels;
+   std::vector<uint64_t> _level_offsets;
+};
+
+} // namespace tools
+} // namespace eosio
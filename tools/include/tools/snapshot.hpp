@@ -0,0 +1,106 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Parsing of chain snapshot dumps and the airdrop rules applied to them.
+ *  A dump is split at line boundaries and each part is parsed on its own
+ *  thread; the per-thread results are merged into one list sorted by owner.
+ */
+#pragma once
+
+#include <eosiolib/name.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace eosio
+{
+namespace tools
+{
+
+/// One balance, in units of 0.0001 like PEOS and EOS.
+struct holder
+{
+   name owner;
+   int64_t amount = 0;
+};
+
+enum class snapshot_format
+{
+   /// One holder per line, fields separated by commas (no commas inside quotes).
+   csv,
+   /// One JSON object per line, either JSON Lines or an array with an object per line.
+   json
+};
+
+struct parse_options
+{
+   snapshot_format format = snapshot_format::csv;
+
+   /// CSV columns, counted from 0; a negative column counts from the end.
+   int account_column = 0;
+   int amount_column = -1;
+
+   /// JSON members; amounts may be numbers or strings like "12.3456 EOS".
+   std::string account_key = "account";
+   std::string amount_key = "balance";
+
+   /// 0 uses every core.
+   unsigned threads = 0;
+};
+
+struct parse_stats
+{
+   uint64_t lines = 0;
+   uint64_t records = 0;
+
+   /// Lines with an account field that isn't a valid name or amount; a CSV header counts here.
+   uint64_t invalid = 0;
+};
+
+/// Parses a whole dump; rows of the same owner are summed. Sorted by owner.
+std::vector<holder> parse_snapshot(std::string_view dump, const parse_options &options, parse_stats &stats);
+
+/// Parses "123.4567", optionally quoted or followed by a symbol; digits past the fourth decimal are dropped.
+bool parse_amount(std::string_view text, int64_t &amount);
+
+/// Parses a normalized account name, rejecting anything name::to_string() wouldn't give back.
+bool parse_name(std::string_view text, name &owner);
+
+/// Reads one account per line; blank lines and lines starting with '#' are ignored.
+std::unordered_set<uint64_t> read_name_list(const std::string &path);
+
+struct airdrop_rules
+{
+   /// Each holder receives amount * ratio_num / ratio_den, rounded down.
+   uint64_t ratio_num = 1;
+   uint64_t ratio_den = 1;
+
+   /// Smaller allocations, and those of the routed accounts, go to route_to instead.
+   int64_t minimum = 1'0000;
+   name route_to = name("thepeostoken");
+
+   std::unordered_set<uint64_t> excluded;
+   std::unordered_set<uint64_t> routed;
+};
+
+struct airdrop
+{
+   /// Sorted by owner; never contains route_to or excluded accounts.
+   std::vector<holder> recipients;
+   int64_t distributed = 0;
+
+   int64_t routed = 0;
+   uint64_t routed_holders = 0;
+
+   int64_t excluded = 0;
+   uint64_t excluded_holders = 0;
+};
+
+airdrop allocate(const std::vector<holder> &holders, const airdrop_rules &rules);
+
+} // namespace tools
+} // namespace eosio
@@ -0,0 +1,94 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#include <tools/mapped_file.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace eosio
+{
+namespace tools
+{
+
+static std::runtime_error file_error(const std::string &what, const std::string &path)
+{
+   return std::runtime_error(what + " " + path + ": " + strerror(errno));
+}
+
+mapped_file::mapped_file(const std::string &path)
+{
+   int fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0)
+   {
+      throw file_error("cannot open", path);
+   }
+
+   struct stat st;
+   if (fstat(fd, &st) != 0)
+   {
+      ::close(fd);
+      throw file_error("cannot stat", path);
+   }
+
+   _size = size_t(st.st_size);
+   map(fd, path, false);
+}
+
+mapped_file::mapped_file(const std::string &path, size_t size) : _size(size)
+{
+   int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0)
+   {
+      throw file_error("cannot create", path);
+   }
+   if (ftruncate(fd, off_t(size)) != 0)
+   {
+      ::close(fd);
+      throw file_error("cannot resize", path);
+   }
+   map(fd, path, true);
+}
+
+void mapped_file::map(int fd, const std::string &path, bool writable)
+{
+   if (_size > 0)
+   {
+      void *addr = mmap(nullptr, _size, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                        writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED)
+      {
+         ::close(fd);
+         throw file_error("cannot map", path);
+      }
+      _data = static_cast<char *>(addr);
+   }
+   ::close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+   if (_data)
+   {
+      munmap(_data, _size);
+   }
+}
+
+void mapped_file::sequential()
+{
+   if (_data)
+   {
+      madvise(_data, _size, MADV_SEQUENTIAL);
+   }
+}
+
+} // namespace tools
+} // namespace eosio
@@ -0,0 +1,271 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#include <tools/merkle.hpp>
+
+#include <eosiolib/system.hpp>
+
+#include <openssl/sha.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace eosio
+{
+namespace tools
+{
+
+namespace
+{
+
+constexpr char proof_magic[8] = {'P', 'E', 'O', 'S', 'D', 'R', 'O', 'P'};
+constexpr uint32_t proof_version = 1;
+
+/// Below this many items per thread a level is hashed on the calling thread.
+constexpr size_t min_parallel_items = 1 << 14;
+
+template <typename F>
+void parallel_for(size_t count, unsigned threads, F &&f)
+{
+   threads = unsigned(std::min<size_t>(threads, count / min_parallel_items));
+   if (threads <= 1)
+   {
+      f(size_t(0), count);
+      return;
+   }
+
+   std::vector<std::thread> workers;
+   for (unsigned t = 0; t < threads; ++t)
+   {
+      workers.emplace_back([&, t] { f(count * t / threads, count * (t + 1) / threads); });
+   }
+   for (auto &worker : workers)
+   {
+      worker.join();
+   }
+}
+
+std::vector<uint64_t> level_sizes(uint64_t leaf_count)
+{
+   std::vector<uint64_t> sizes = {leaf_count};
+   while (sizes.back() > 1)
+   {
+      sizes.push_back((sizes.back() + 1) / 2);
+   }
+   return sizes;
+}
+
+uint64_t bucket_of(uint64_t owner, uint64_t bucket_count)
+{
+   // Fibonacci hashing; bucket_count is a power of two of at least 2
+   return (owner * 0x9E3779B97F4A7C15ull) >> (64 - __builtin_ctzll(bucket_count));
+}
+
+struct proof_layout
+{
+   std::vector<uint64_t> levels;
+   uint64_t bucket_count = 2;
+   size_t buckets = sizeof(proof_header);
+   size_t leaves = 0;
+   size_t nodes = 0;
+   size_t size = 0;
+
+   explicit proof_layout(uint64_t leaf_count) : levels(level_sizes(leaf_count))
+   {
+      // at most half full, so probes stay short
+      while (bucket_count < 2 * leaf_count)
+      {
+         bucket_count <<= 1;
+      }
+      leaves = buckets + bucket_count * sizeof(proof_entry);
+      nodes = leaves + leaf_count * sizeof(proof_leaf);
+
+      uint64_t node_count = 0;
+      for (auto level : levels)
+      {
+         node_count += level;
+      }
+      size = nodes + node_count * sizeof(drop_hash);
+   }
+};
+
+} // namespace
+
+drop_hash drop_leaf_hash(name owner, int64_t amount, symbol sym)
+{
+   // the contract's drop_leaf: three packed little-endian 64-bit fields
+   uint8_t leaf[24];
+   const uint64_t fields[3] = {owner.value, uint64_t(amount), sym.raw()};
+   memcpy(leaf, fields, sizeof(leaf));
+
+   drop_hash hash;
+   SHA256(leaf, sizeof(leaf), hash.data());
+   return hash;
+}
+
+drop_hash drop_node_hash(const drop_hash &a, const drop_hash &b)
+{
+   uint8_t node[64];
+   const bool swap = b < a;
+   memcpy(node, (swap ? b : a).data(), 32);
+   memcpy(node + 32, (swap ? a : b).data(), 32);
+
+   drop_hash hash;
+   SHA256(node, sizeof(node), hash.data());
+   return hash;
+}
+
+std::string to_hex(const drop_hash &hash)
+{
+   static const char *digits = "0123456789abcdef";
+   std::string hex;
+   hex.reserve(64);
+   for (auto c : hash)
+   {
+      hex += digits[c >> 4];
+      hex += digits[c & 0xF];
+   }
+   return hex;
+}
+
+drop_hash build_proof_file(const std::string &path, const std::vector<holder> &leaves, symbol sym, unsigned threads)
+{
+   check(!leaves.empty(), "no leaves to build a tree of");
+   if (!threads)
+   {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+   }
+
+   const proof_layout layout(leaves.size());
+   mapped_file file(path, layout.size);
+   auto *header = reinterpret_cast<proof_header *>(file.data());
+   auto *buckets = reinterpret_cast<proof_entry *>(file.data() + layout.buckets);
+   auto *records = reinterpret_cast<proof_leaf *>(file.data() + layout.leaves);
+   auto *nodes = reinterpret_cast<drop_hash *>(file.data() + layout.nodes);
+
+   // the lookup table touches other pages than the hashing, so it fills meanwhile
+   std::exception_ptr table_error;
+   std::thread table([&] {
+      try
+      {
+         for (uint64_t i = 0; i < leaves.size(); ++i)
+         {
+            const auto owner = leaves[i].owner.value;
+            check(i == 0 || leaves[i - 1].owner.value < owner, "leaves must be sorted by owner and unique");
+            auto bucket = bucket_of(owner, layout.bucket_count);
+            while (buckets[bucket].leaf)
+            {
+               bucket = (bucket + 1) & (layout.bucket_count - 1);
+            }
+            buckets[bucket] = {owner, i + 1};
+         }
+      }
+      catch (...)
+      {
+         table_error = std::current_exception();
+      }
+   });
+
+   parallel_for(leaves.size(), threads, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i)
+      {
+         records[i] = {leaves[i].owner.value, leaves[i].amount};
+         nodes[i] = drop_leaf_hash(leaves[i].owner, leaves[i].amount, sym);
+      }
+   });
+
+   auto *children = nodes;
+   for (size_t level = 1; level < layout.levels.size(); ++level)
+   {
+      const auto child_count = layout.levels[level - 1];
+      auto *parents = children + child_count;
+      parallel_for(layout.levels[level], threads, [&](size_t begin, size_t end) {
+         for (size_t i = begin; i < end; ++i)
+         {
+            parents[i] = 2 * i + 1 < child_count ? drop_node_hash(children[2 * i], children[2 * i + 1]) : children[2 * i];
+         }
+      });
+      children = parents;
+   }
+
+   table.join();
+   if (table_error)
+   {
+      std::rethrow_exception(table_error);
+   }
+
+   memcpy(header->magic, proof_magic, sizeof(proof_magic));
+   header->version = proof_version;
+   header->levels = uint32_t(layout.levels.size());
+   header->leaf_count = leaves.size();
+   header->bucket_count = layout.bucket_count;
+   header->symbol = sym.raw();
+   header->root = *children;
+   return header->root;
+}
+
+proof_file::proof_file(const std::string &path) : _file(path)
+{
+   if (_file.size() < sizeof(proof_header) || memcmp(_file.data(), proof_magic, sizeof(proof_magic)) != 0)
+   {
+      throw std::runtime_error(path + " is not a proof file");
+   }
+   _header = reinterpret_cast<const proof_header *>(_file.data());
+   if (_header->version != proof_version)
+   {
+      throw std::runtime_error(path + " has unsupported version " + std::to_string(_header->version));
+   }
+
+   const proof_layout layout(_header->leaf_count);
+   if (_header->leaf_count == 0 || _file.size() != layout.size || _header->bucket_count != layout.bucket_count ||
+       _header->levels != layout.levels.size())
+   {
+      throw std::runtime_error(path + " is truncated or corrupt");
+   }
+
+   _buckets = reinterpret_cast<const proof_entry *>(_file.data() + layout.buckets);
+   _leaves = reinterpret_cast<const proof_leaf *>(_file.data() + layout.leaves);
+   _nodes = reinterpret_cast<const drop_hash *>(_file.data() + layout.nodes);
+
+   _levels = layout.levels;
+   uint64_t offset = 0;
+   for (auto level : _levels)
+   {
+      _level_offsets.push_back(offset);
+      offset += level;
+   }
+}
+
+std::optional<drop_proof> proof_file::find(name owner) const
+{
+   const auto mask = _header->bucket_count - 1;
+   for (auto bucket = bucket_of(owner.value, _header->bucket_count); _buckets[bucket].leaf; bucket = (bucket + 1) & mask)
+   {
+      if (_buckets[bucket].owner == owner.value)
+      {
+         return proof(_buckets[bucket].leaf - 1);
+      }
+   }
+   return std::nullopt;
+}
+
+drop_proof proof_file::proof(uint64_t leaf) const
+{
+   drop_proof proof{name(_leaves[leaf].owner), _leaves[leaf].amount, {}};
+   for (size_t level = 0; level + 1 < _levels.size(); ++level, leaf >>= 1)
+   {
+      const auto sibling = leaf ^ 1;
+      if (sibling < _levels[level])
+      {
+         proof.siblings.push_back(_nodes[_level_offsets[level] + sibling]);
+      }
+   }
+   return proof;
+}
+
+} // namespace tools
+} // namespace eosio
@@ -0,0 +1,109 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Builds the airdrop Merkle tree of an allocation list, as written by
+ *  snapshot_ingest --allocations, into a proof file and prints its root for
+ *  setdroproot.
+ *
+ *      merkle_build [options] allocations.csv drop.proofs
+ */
+
+#include <tools/merkle.hpp>
+
+#include <token.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+using namespace eosio;
+using namespace eosio::tools;
+
+namespace
+{
+
+void usage()
+{
+   std::cerr <<
+      "usage: merkle_build [options] <allocations> <proof file>\n"
+      "\n"
+      "  --format csv|json        allocation format (csv)\n"
+      "  --account-column N       csv column of the account (0)\n"
+      "  --amount-column N        csv column of the amount (-1)\n"
+      "  --account-key KEY        json member of the account (account)\n"
+      "  --amount-key KEY         json member of the amount (balance)\n"
+      "  --threads N              parser and hashing threads, 0 for every core (0)\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   try
+   {
+      parse_options options;
+      std::vector<std::string> paths;
+      for (int i = 1; i < argc; ++i)
+      {
+         std::string arg = argv[i];
+         auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+            {
+               throw std::runtime_error(arg + " needs a value");
+            }
+            return argv[++i];
+         };
+
+         if (arg == "--format")
+            options.format = value() == "json" ? snapshot_format::json : snapshot_format::csv;
+         else if (arg == "--account-column")
+            options.account_column = std::stoi(value());
+         else if (arg == "--amount-column")
+            options.amount_column = std::stoi(value());
+         else if (arg == "--account-key")
+            options.account_key = value();
+         else if (arg == "--amount-key")
+            options.amount_key = value();
+         else if (arg == "--threads")
+            options.threads = unsigned(std::stoul(value()));
+         else if (arg == "-h" || arg == "--help")
+         {
+            usage();
+            return 0;
+         }
+         else if (!arg.empty() && arg[0] == '-')
+            throw std::runtime_error("unknown option " + arg);
+         else
+            paths.push_back(arg);
+      }
+      if (paths.size() != 2)
+      {
+         usage();
+         return 1;
+      }
+
+      const auto started = std::chrono::steady_clock::now();
+      mapped_file input(paths[0]);
+      input.sequential();
+
+      parse_stats stats;
+      const auto leaves = parse_snapshot(input.view(), options, stats);
+      const auto parsed = std::chrono::steady_clock::now();
+
+      const auto root = build_proof_file(paths[1], leaves, PEOS_SYMBOL, options.threads);
+      const auto finished = std::chrono::steady_clock::now();
+
+      const auto ms = [](auto d) { return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+      fprintf(stderr, "%zu leaves (%llu invalid lines) parsed in %lld ms, tree built in %lld ms\n", leaves.size(),
+              (unsigned long long)stats.invalid, ms(parsed - started), ms(finished - parsed));
+      printf("%s\n", to_hex(root).c_str());
+   }
+   catch (const std::exception &e)
+   {
+      fprintf(stderr, "merkle_build: %s\n", e.what());
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,84 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Looks up claimdrop arguments in a proof file written by merkle_build.
+ *  Prints one JSON object per account, {"owner", "quantity", "proof"}, in the
+ *  shape of the claimdrop action's data.
+ *
+ *      merkle_proof drop.proofs account...
+ *      merkle_proof drop.proofs --all > proofs.jsonl
+ */
+
+#include <tools/merkle.hpp>
+
+#include <eosiolib/asset.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace eosio;
+using namespace eosio::tools;
+
+namespace
+{
+
+void print_proof(FILE *out, const drop_proof &proof, symbol sym)
+{
+   std::string line = "{\"owner\":\"" + proof.owner.to_string() + "\",\"quantity\":\"" +
+                      asset(proof.amount, sym).to_string() + "\",\"proof\":[";
+   for (size_t i = 0; i < proof.siblings.size(); ++i)
+   {
+      line += (i ? ",\"" : "\"") + to_hex(proof.siblings[i]) + "\"";
+   }
+   line += "]}\n";
+   fwrite(line.data(), 1, line.size(), out);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   if (argc < 3)
+   {
+      fprintf(stderr, "usage: merkle_proof <proof file> (--all | account...)\n");
+      return 1;
+   }
+
+   try
+   {
+      proof_file proofs(argv[1]);
+
+      if (argc == 3 && strcmp(argv[2], "--all") == 0)
+      {
+         static char buffer[1 << 20];
+         setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+         for (uint64_t leaf = 0; leaf < proofs.leaf_count(); ++leaf)
+         {
+            print_proof(stdout, proofs.proof(leaf), proofs.sym());
+         }
+         return fflush(stdout) == 0 ? 0 : 1;
+      }
+
+      int missing = 0;
+      for (int i = 2; i < argc; ++i)
+      {
+         name owner;
+         auto proof = parse_name(argv[i], owner) ? proofs.find(owner) : std::nullopt;
+         if (!proof)
+         {
+            fprintf(stderr, "merkle_proof: %s is not in the airdrop\n", argv[i]);
+            ++missing;
+            continue;
+         }
+         print_proof(stdout, *proof, proofs.sym());
+      }
+      return missing ? 2 : 0;
+   }
+   catch (const std::exception &e)
+   {
+      fprintf(stderr, "merkle_proof: %s\n", e.what());
+      return 1;
+   }
+}
@@ -0,0 +1,414 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+
+#include <tools/snapshot.hpp>
+
+#include <eosiolib/asset.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace eosio
+{
+namespace tools
+{
+
+namespace
+{
+
+std::string_view trim(std::string_view text)
+{
+   while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '"'))
+   {
+      text.remove_prefix(1);
+   }
+   while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '"' || text.back() == '\r'))
+   {
+      text.remove_suffix(1);
+   }
+   return text;
+}
+
+bool csv_field(std::string_view line, int column, std::string_view &field)
+{
+   if (column < 0)
+   {
+      column += int(std::count(line.begin(), line.end(), ',')) + 1;
+      if (column < 0)
+      {
+         return false;
+      }
+   }
+
+   size_t start = 0;
+   for (; column > 0; --column)
+   {
+      start = line.find(',', start);
+      if (start == std::string_view::npos)
+      {
+         return false;
+      }
+      ++start;
+   }
+   auto comma = line.find(',', start);
+   field = trim(line.substr(start, comma == std::string_view::npos ? std::string_view::npos : comma - start));
+   return true;
+}
+
+bool json_member(std::string_view line, const std::string &key, std::string_view &value)
+{
+   const std::string quoted = "\"" + key + "\"";
+   auto pos = line.find(quoted);
+   if (pos == std::string_view::npos)
+   {
+      return false;
+   }
+   pos = line.find_first_not_of(" \t", pos + quoted.size());
+   if (pos == std::string_view::npos || line[pos] != ':')
+   {
+      return false;
+   }
+   pos = line.find_first_not_of(" \t", pos + 1);
+   if (pos == std::string_view::npos)
+   {
+      return false;
+   }
+
+   if (line[pos] == '"')
+   {
+      auto end = line.find('"', pos + 1);
+      if (end == std::string_view::npos)
+      {
+         return false;
+      }
+      value = line.substr(pos + 1, end - pos - 1);
+   }
+   else
+   {
+      auto end = line.find_first_of(",} \t\r", pos);
+      value = line.substr(pos, end == std::string_view::npos ? std::string_view::npos : end - pos);
+   }
+   return true;
+}
+
+/// Sorts by owner and sums rows of the same owner in place.
+void sort_and_merge(std::vector<holder> &holders)
+{
+   std::sort(holders.begin(), holders.end(),
+             [](const holder &a, const holder &b) { return a.owner.value < b.owner.value; });
+   size_t out = 0;
+   for (size_t i = 0; i < holders.size(); ++i)
+   {
+      if (out > 0 && holders[out - 1].owner == holders[i].owner)
+      {
+         holders[out - 1].amount += holders[i].amount;
+         check(holders[out - 1].amount <= asset::max_amount, "balance of " + holders[i].owner.to_string() + " overflows");
+      }
+      else
+      {
+         holders[out++] = holders[i];
+      }
+   }
+   holders.resize(out);
+}
+
+void parse_part(std::string_view part, const parse_options &options, std::vector<holder> &holders, parse_stats &stats)
+{
+   while (!part.empty())
+   {
+      auto newline = part.find('\n');
+      auto line = part.substr(0, newline);
+      part.remove_prefix(newline == std::string_view::npos ? part.size() : newline + 1);
+      ++stats.lines;
+
+      std::string_view account, amount;
+      if (options.format == snapshot_format::csv)
+      {
+         if (trim(line).empty())
+         {
+            continue;
+         }
+         if (!csv_field(line, options.account_column, account) || !csv_field(line, options.amount_column, amount))
+         {
+            ++stats.invalid;
+            continue;
+         }
+      }
+      else
+      {
+         // array brackets and objects of other kinds carry no account
+         if (!json_member(line, options.account_key, account))
+         {
+            continue;
+         }
+         if (!json_member(line, options.amount_key, amount))
+         {
+            ++stats.invalid;
+            continue;
+         }
+      }
+
+      holder h;
+      if (!parse_name(account, h.owner) || !parse_amount(amount, h.amount))
+      {
+         ++stats.invalid;
+         continue;
+      }
+      ++stats.records;
+      if (h.amount > 0)
+      {
+         holders.push_back(h);
+      }
+   }
+
+   sort_and_merge(holders);
+}
+
+} // namespace
+
+bool parse_amount(std::string_view text, int64_t &amount)
+{
+   text = trim(text);
+
+   uint64_t value = 0;
+   size_t i = 0;
+   size_t digits = 0;
+   for (; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i, ++digits)
+   {
+      // 16 integer digits exceed asset::max_amount in 0.0001 units
+      if (digits == 15)
+      {
+         return false;
+      }
+      value = value * 10 + (text[i] - '0');
+   }
+   if (digits == 0)
+   {
+      return false;
+   }
+
+   uint64_t fraction = 0;
+   int decimals = 0;
+   if (i < text.size() && text[i] == '.')
+   {
+      for (++i; i < text.size() && text[i] >= '0' && text[i] <= '9'; ++i)
+      {
+         if (decimals < 4)
+         {
+            fraction = fraction * 10 + (text[i] - '0');
+            ++decimals;
+         }
+      }
+   }
+   for (; decimals < 4; ++decimals)
+   {
+      fraction *= 10;
+   }
+
+   // only a symbol may follow, e.g. "12.3456 EOS"
+   for (; i < text.size(); ++i)
+   {
+      if (text[i] != ' ' && (text[i] < 'A' || text[i] > 'Z'))
+      {
+         return false;
+      }
+   }
+
+   value = value * 10'000 + fraction;
+   if (value > uint64_t(asset::max_amount))
+   {
+      return false;
+   }
+   amount = int64_t(value);
+   return true;
+}
+
+bool parse_name(std::string_view text, name &owner)
+{
+   text = trim(text);
+   if (text.empty() || text.size() > 12)
+   {
+      return false;
+   }
+   try
+   {
+      owner = name(text);
+   }
+   catch (const std::invalid_argument &)
+   {
+      return false;
+   }
+   return owner.to_string() == text;
+}
+
+std::vector<holder> parse_snapshot(std::string_view dump, const parse_options &options, parse_stats &stats)
+{
+   unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+   // small dumps aren't worth a thread per core
+   threads = unsigned(std::max<size_t>(1, std::min<size_t>(threads, dump.size() / (1 << 20))));
+
+   std::vector<std::string_view> parts;
+   size_t start = 0;
+   for (unsigned i = 1; i <= threads && start < dump.size(); ++i)
+   {
+      size_t end = i == threads ? dump.size() : dump.size() / threads * i;
+      if (end < start)
+      {
+         end = start;
+      }
+      auto newline = dump.find('\n', end);
+      end = newline == std::string_view::npos || i == threads ? dump.size() : newline + 1;
+      parts.push_back(dump.substr(start, end - start));
+      start = end;
+   }
+
+   std::vector<std::vector<holder>> results(parts.size());
+   std::vector<parse_stats> part_stats(parts.size());
+   std::vector<std::exception_ptr> errors(parts.size());
+   std::vector<std::thread> workers;
+   for (size_t i = 0; i < parts.size(); ++i)
+   {
+      workers.emplace_back([&, i] {
+         try
+         {
+            parse_part(parts[i], options, results[i], part_stats[i]);
+         }
+         catch (...)
+         {
+            errors[i] = std::current_exception();
+         }
+      });
+   }
+   for (auto &worker : workers)
+   {
+      worker.join();
+   }
+   for (auto &error : errors)
+   {
+      if (error)
+      {
+         std::rethrow_exception(error);
+      }
+   }
+
+   size_t total = 0;
+   for (size_t i = 0; i < parts.size(); ++i)
+   {
+      stats.lines += part_stats[i].lines;
+      stats.records += part_stats[i].records;
+      stats.invalid += part_stats[i].invalid;
+      total += results[i].size();
+   }
+
+   // each part is sorted already, so the concatenation is merged pairwise
+   std::vector<holder> holders;
+   holders.reserve(total);
+   std::vector<size_t> bounds = {0};
+   for (auto &result : results)
+   {
+      holders.insert(holders.end(), result.begin(), result.end());
+      bounds.push_back(holders.size());
+      std::vector<holder>().swap(result);
+   }
+
+   const auto by_owner = [](const holder &a, const holder &b) { return a.owner.value < b.owner.value; };
+   while (bounds.size() > 2)
+   {
+      std::vector<size_t> merged = {0};
+      std::vector<std::thread> mergers;
+      for (size_t i = 0; i + 2 < bounds.size(); i += 2)
+      {
+         mergers.emplace_back([&, i] {
+            std::inplace_merge(holders.begin() + bounds[i], holders.begin() + bounds[i + 1],
+                               holders.begin() + bounds[i + 2], by_owner);
+         });
+         merged.push_back(bounds[i + 2]);
+      }
+      if (bounds.size() % 2 == 0)
+      {
+         merged.push_back(bounds.back());
+      }
+      for (auto &merger : mergers)
+      {
+         merger.join();
+      }
+      bounds = std::move(merged);
+   }
+
+   // owners listed in several parts are now adjacent
+   sort_and_merge(holders);
+   return holders;
+}
+
+std::unordered_set<uint64_t> read_name_list(const std::string &path)
+{
+   std::ifstream in(path);
+   if (!in)
+   {
+      throw std::runtime_error("cannot open " + path);
+   }
+
+   std::unordered_set<uint64_t> names;
+   std::string line;
+   for (size_t number = 1; std::getline(in, line); ++number)
+   {
+      auto text = trim(line);
+      if (text.empty() || text.front() == '#')
+      {
+         continue;
+      }
+      name account;
+      if (!parse_name(text, account))
+      {
+         throw std::runtime_error(path + ":" + std::to_string(number) + ": invalid account name");
+      }
+      names.insert(account.value);
+   }
+   return names;
+}
+
+airdrop allocate(const std::vector<holder> &holders, const airdrop_rules &rules)
+{
+   check(rules.ratio_num > 0 && rules.ratio_den > 0, "ratio must be positive");
+
+   airdrop result;
+   result.recipients.reserve(holders.size());
+   for (const auto &h : holders)
+   {
+      if (rules.excluded.count(h.owner.value))
+      {
+         result.excluded += h.amount;
+         ++result.excluded_holders;
+         continue;
+      }
+
+      const auto scaled = (unsigned __int128)h.amount * rules.ratio_num / rules.ratio_den;
+      check(scaled <= (unsigned __int128)asset::max_amount, "allocation of " + h.owner.to_string() + " overflows");
+      const auto amount = int64_t(scaled);
+      if (amount == 0)
+      {
+         continue;
+      }
+
+      if (amount < rules.minimum || h.owner == rules.route_to || rules.routed.count(h.owner.value))
+      {
+         result.routed += amount;
+         ++result.routed_holders;
+      }
+      else
+      {
+         result.recipients.push_back({h.owner, amount});
+         result.distributed += amount;
+      }
+      check(result.routed <= asset::max_amount && result.distributed <= asset::max_amount, "airdrop total overflows");
+   }
+   return result;
+}
+
+} // namespace tools
+} // namespace eosio
@@ -0,0 +1,423 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Turns a chain snapshot dump into the actions that perform the airdrop:
+ *  issue actions for the distributed and routed totals, then transfermany
+ *  batches from the distributor to every recipient. Actions are written one
+ *  per line in the JSON form nodeos accepts, with their data already packed,
+ *  ready to be wrapped into transactions and signed.
+ *
+ *      snapshot_ingest [options] snapshot.csv > actions.jsonl
+ */
+
+#include <tools/mapped_file.hpp>
+#include <tools/snapshot.hpp>
+
+#include <token.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+using namespace eosio;
+using namespace eosio::tools;
+
+namespace
+{
+
+struct ingest_options
+{
+   parse_options parse;
+   airdrop_rules rules;
+   name issuer = name("thepeostoken");
+   name distributor = name("thepeostoken");
+   std::string memo = "pEOS airdrop";
+
+   /// What issue may still give each account under its vesting schedule; the
+   /// defaults are the full budgets the contract had before setvesting.
+   std::map<uint64_t, int64_t> budgets = {
+      {name("thepeostoken").value, 596'224'1696ll},
+      {name("peosmarketin").value, 50'000'000'0000ll},
+      {name("peosteamfund").value, 200'000'000'0000ll},
+   };
+
+   /// Bounds on each transfermany; the data of issue actions is always far below.
+   size_t max_bytes = 8192;
+   size_t max_recipients = 250;
+
+   std::string input;
+   std::string output;
+   std::string allocations;
+};
+
+void usage()
+{
+   std::cerr <<
+      "usage: snapshot_ingest [options] <snapshot>\n"
+      "\n"
+      "input:\n"
+      "  --format csv|json        dump format (csv)\n"
+      "  --account-column N       csv column of the account, negative counts from the end (0)\n"
+      "  --amount-column N        csv column of the balance (-1)\n"
+      "  --account-key KEY        json member of the account (account)\n"
+      "  --amount-key KEY         json member of the balance (balance)\n"
+      "  --threads N              parser threads, 0 for every core (0)\n"
+      "\n"
+      "airdrop rules:\n"
+      "  --ratio NUM/DEN          PEOS per snapshot unit (1/1)\n"
+      "  --minimum AMOUNT         smaller allocations are routed (1.0000)\n"
+      "  --route-to ACCOUNT       receives routed allocations (thepeostoken)\n"
+      "  --routed FILE            accounts always routed, e.g. contracts\n"
+      "  --exclude FILE           accounts left out of the airdrop\n"
+      "\n"
+      "output:\n"
+      "  --issuer ACCOUNT         token issuer authorizing issue (thepeostoken)\n"
+      "  --distributor ACCOUNT    account issued to and sending the batches (thepeostoken);\n"
+      "                           any other than the issuer leaves every row claimed, out\n"
+      "                           of recover's reach\n"
+      "  --budget ACCOUNT=AMOUNT  issuance ACCOUNT's vesting schedule still allows; the\n"
+      "                           defaults are thepeostoken 596224.1696, peosmarketin\n"
+      "                           50000000.0000 and peosteamfund 200000000.0000\n"
+      "  --memo TEXT              memo of every action (pEOS airdrop)\n"
+      "  --max-bytes N            packed data bound of a transfermany (8192)\n"
+      "  --max-recipients N       recipients bound of a transfermany (250)\n"
+      "  --out FILE               write actions here instead of stdout\n"
+      "  --allocations FILE       also write the recipients as account,amount lines,\n"
+      "                           e.g. as input of merkle_build\n";
+}
+
+name parse_account_arg(const std::string &text)
+{
+   name account;
+   if (!parse_name(text, account))
+   {
+      throw std::runtime_error("invalid account name " + text);
+   }
+   return account;
+}
+
+ingest_options parse_args(int argc, char **argv)
+{
+   ingest_options options;
+   for (int i = 1; i < argc; ++i)
+   {
+      std::string arg = argv[i];
+      auto value = [&]() -> std::string {
+         if (i + 1 >= argc)
+         {
+            throw std::runtime_error(arg + " needs a value");
+         }
+         return argv[++i];
+      };
+
+      if (arg == "--format")
+      {
+         auto format = value();
+         if (format != "csv" && format != "json")
+         {
+            throw std::runtime_error("unknown format " + format);
+         }
+         options.parse.format = format == "csv" ? snapshot_format::csv : snapshot_format::json;
+      }
+      else if (arg == "--account-column")
+         options.parse.account_column = std::stoi(value());
+      else if (arg == "--amount-column")
+         options.parse.amount_column = std::stoi(value());
+      else if (arg == "--account-key")
+         options.parse.account_key = value();
+      else if (arg == "--amount-key")
+         options.parse.amount_key = value();
+      else if (arg == "--threads")
+         options.parse.threads = unsigned(std::stoul(value()));
+      else if (arg == "--ratio")
+      {
+         auto ratio = value();
+         auto slash = ratio.find('/');
+         options.rules.ratio_num = std::stoull(ratio.substr(0, slash));
+         options.rules.ratio_den = slash == std::string::npos ? 1 : std::stoull(ratio.substr(slash + 1));
+      }
+      else if (arg == "--minimum")
+      {
+         if (!parse_amount(value(), options.rules.minimum))
+         {
+            throw std::runtime_error("invalid minimum");
+         }
+      }
+      else if (arg == "--route-to")
+         options.rules.route_to = parse_account_arg(value());
+      else if (arg == "--routed")
+         options.rules.routed = read_name_list(value());
+      else if (arg == "--exclude")
+         options.rules.excluded = read_name_list(value());
+      else if (arg == "--issuer")
+         options.issuer = parse_account_arg(value());
+      else if (arg == "--distributor")
+         options.distributor = parse_account_arg(value());
+      else if (arg == "--budget")
+      {
+         const auto budget = value();
+         const auto eq = budget.find('=');
+         int64_t amount;
+         if (eq == std::string::npos || !parse_amount(std::string_view(budget).substr(eq + 1), amount))
+         {
+            throw std::runtime_error("invalid budget " + budget + ", expected ACCOUNT=AMOUNT");
+         }
+         options.budgets[parse_account_arg(budget.substr(0, eq)).value] = amount;
+      }
+      else if (arg == "--memo")
+         options.memo = value();
+      else if (arg == "--max-bytes")
+         options.max_bytes = std::stoul(value());
+      else if (arg == "--max-recipients")
+         options.max_recipients = std::stoul(value());
+      else if (arg == "--out")
+         options.output = value();
+      else if (arg == "--allocations")
+         options.allocations = value();
+      else if (arg == "-h" || arg == "--help")
+      {
+         usage();
+         exit(0);
+      }
+      else if (!arg.empty() && arg[0] == '-')
+         throw std::runtime_error("unknown option " + arg);
+      else if (options.input.empty())
+         options.input = arg;
+      else
+         throw std::runtime_error("only one snapshot may be given");
+   }
+
+   if (options.input.empty())
+   {
+      usage();
+      exit(1);
+   }
+   if (options.memo.size() > 256)
+   {
+      throw std::runtime_error("memo has more than 256 bytes");
+   }
+   return options;
+}
+
+class action_writer
+{
+ public:
+   explicit action_writer(FILE *out) : _out(out) {}
+
+   void write(name account, name action, name actor, const std::vector<char> &data)
+   {
+      static const char *digits = "0123456789abcdef";
+
+      _line.clear();
+      _line += "{\"account\":\"" + account.to_string() + "\",\"name\":\"" + action.to_string() +
+               "\",\"authorization\":[{\"actor\":\"" + actor.to_string() +
+               "\",\"permission\":\"active\"}],\"data\":\"";
+      for (unsigned char c : data)
+      {
+         _line += digits[c >> 4];
+         _line += digits[c & 0xF];
+      }
+      _line += "\"}\n";
+      if (fwrite(_line.data(), 1, _line.size(), _out) != _line.size())
+      {
+         throw std::runtime_error("cannot write actions");
+      }
+      ++_actions;
+   }
+
+   uint64_t actions() const { return _actions; }
+
+ private:
+   FILE *_out;
+   std::string _line;
+   uint64_t _actions = 0;
+};
+
+size_t varuint_size(uint64_t v)
+{
+   size_t size = 1;
+   for (; v >= 0x80; v >>= 7)
+   {
+      ++size;
+   }
+   return size;
+}
+
+/// Recipients that fit one transfermany: from, recipient count, 24 bytes per recipient, memo.
+size_t batch_capacity(const ingest_options &options)
+{
+   const size_t recipient_size = sizeof(uint64_t) + sizeof(int64_t) + sizeof(uint64_t);
+   const size_t fixed = sizeof(uint64_t) + varuint_size(options.max_recipients) +
+                        varuint_size(options.memo.size()) + options.memo.size();
+   check(options.max_bytes >= fixed + recipient_size, "--max-bytes too small for a single recipient");
+   return std::min(options.max_recipients, (options.max_bytes - fixed) / recipient_size);
+}
+
+std::string format_amount(int64_t amount)
+{
+   return asset(amount, PEOS_SYMBOL).to_string();
+}
+
+/// validate_vesting rejects an issue beyond the recipient's budget, which
+/// would strand every transfermany after it; fail before writing any.
+void check_budgets(const ingest_options &options, const airdrop &drop)
+{
+   // raising the budget is the fix; switching distributors changes what recover can do
+   const std::string keep_issuer = ". Keep the issuer as --distributor: batches from any other account "
+                                   "leave every row claimed and paid by it, so recover can't sweep unclaimed airdrops";
+   std::map<uint64_t, int64_t> issued;
+   issued[options.rules.route_to.value] += drop.routed;
+   issued[options.distributor.value] += drop.distributed;
+   for (const auto &[account, amount] : issued)
+   {
+      if (amount == 0)
+      {
+         continue;
+      }
+      auto budget = options.budgets.find(account);
+      if (budget == options.budgets.end())
+      {
+         throw std::runtime_error(name(account).to_string() + " has no issuance budget; give it a vesting schedule "
+                                  "with setvesting and pass --budget " + name(account).to_string() + "=AMOUNT" +
+                                  keep_issuer);
+      }
+      if (amount > budget->second)
+      {
+         throw std::runtime_error("issuing " + format_amount(amount) + " to " + name(account).to_string() +
+                                  " exceeds its budget of " + format_amount(budget->second) + "; raise its total with "
+                                  "setvesting and pass --budget " + name(account).to_string() + "=AMOUNT" + keep_issuer);
+      }
+   }
+}
+
+void write_allocations(const std::string &path, const airdrop &drop)
+{
+   std::unique_ptr<FILE, int (*)(FILE *)> file(fopen(path.c_str(), "w"), fclose);
+   if (!file)
+   {
+      throw std::runtime_error("cannot create " + path);
+   }
+   for (const auto &r : drop.recipients)
+   {
+      fprintf(file.get(), "%s,%lld.%04lld\n", r.owner.to_string().c_str(),
+              (long long)(r.amount / 10'000), (long long)(r.amount % 10'000));
+   }
+   if (fflush(file.get()) != 0)
+   {
+      throw std::runtime_error("cannot write " + path);
+   }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+   try
+   {
+      const auto options = parse_args(argc, argv);
+      const auto capacity = batch_capacity(options);
+
+      const auto started = std::chrono::steady_clock::now();
+      mapped_file dump(options.input);
+      dump.sequential();
+
+      parse_stats stats;
+      const auto holders = parse_snapshot(dump.view(), options.parse, stats);
+      const auto parsed = std::chrono::steady_clock::now();
+
+      const auto drop = allocate(holders, options.rules);
+      check_budgets(options, drop);
+      if (!options.allocations.empty())
+      {
+         write_allocations(options.allocations, drop);
+      }
+
+      std::unique_ptr<FILE, int (*)(FILE *)> file(nullptr, fclose);
+      FILE *out = stdout;
+      if (!options.output.empty())
+      {
+         file.reset(fopen(options.output.c_str(), "w"));
+         if (!file)
+         {
+            throw std::runtime_error("cannot create " + options.output);
+         }
+         out = file.get();
+      }
+      static char buffer[1 << 20];
+      setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+      action_writer writer(out);
+      const name contract = name("thepeostoken");
+
+      if (drop.routed > 0)
+      {
+         writer.write(contract, name("issue"), options.issuer,
+                      pack(std::make_tuple(options.rules.route_to, asset(drop.routed, PEOS_SYMBOL), options.memo)));
+      }
+      if (drop.distributed > 0)
+      {
+         writer.write(contract, name("issue"), options.issuer,
+                      pack(std::make_tuple(options.distributor, asset(drop.distributed, PEOS_SYMBOL), options.memo)));
+      }
+
+      // the distributor keeps its own allocation from the issue
+      std::vector<token::recipient> batch;
+      batch.reserve(capacity);
+      uint64_t batches = 0;
+      auto flush = [&] {
+         writer.write(contract, name("transfermany"), options.distributor,
+                      pack(std::make_tuple(options.distributor, batch, options.memo)));
+         batch.clear();
+         ++batches;
+      };
+      for (const auto &r : drop.recipients)
+      {
+         if (r.owner == options.distributor)
+         {
+            continue;
+         }
+         batch.push_back({r.owner, asset(r.amount, PEOS_SYMBOL)});
+         if (batch.size() == capacity)
+         {
+            flush();
+         }
+      }
+      if (!batch.empty())
+      {
+         flush();
+      }
+
+      if (fflush(out) != 0)
+      {
+         throw std::runtime_error("cannot write actions");
+      }
+      const auto finished = std::chrono::steady_clock::now();
+
+      const auto ms = [](auto d) { return std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); };
+      fprintf(stderr,
+              "parsed %llu lines, %llu records, %llu invalid, %zu holders in %lld ms\n"
+              "recipients  %zu  %s\n"
+              "routed      %llu  %s to %s\n"
+              "excluded    %llu  %s\n"
+              "wrote %llu actions (%llu transfermany of up to %zu recipients) in %lld ms\n",
+              (unsigned long long)stats.lines, (unsigned long long)stats.records, (unsigned long long)stats.invalid,
+              holders.size(), (long long)ms(parsed - started),
+              drop.recipients.size(), format_amount(drop.distributed).c_str(),
+              (unsigned long long)drop.routed_holders, format_amount(drop.routed).c_str(),
+              options.rules.route_to.to_string().c_str(),
+              (unsigned long long)drop.excluded_holders, format_amount(drop.excluded).c_str(),
+              (unsigned long long)writer.actions(), (unsigned long long)batches, capacity,
+              (long long)ms(finished - started));
+   }
+   catch (const std::exception &e)
+   {
+      fprintf(stderr, "snapshot_ingest: %s\n", e.what());
+      return 1;
+   }
+   return 0;
+}